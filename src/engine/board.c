@@ -68,6 +68,8 @@ Board *board_create(void) {
 	b->side		 = PLAYER_W;
 	b->ep_target = SQ_NONE;
 	b->hash		 = hash_board(b);
+	b->pawn_hash = hash_pawns(b);
+	b->material	 = hash_material(b);
 	b->history	 = history_create();
 	if (!b->history) {
 		log_error("Failed to allocate history");
@@ -83,6 +85,8 @@ void board_init(Board *board) {
 	board->side		 = PLAYER_W;
 	board->ep_target = SQ_NONE;
 	board->hash		 = hash_board(board);
+	board->pawn_hash = hash_pawns(board);
+	board->material	 = hash_material(board);
 	board->history	 = history_create();
 	if (!board->history) {
 		log_error("Failed to allocate history");
@@ -100,6 +104,8 @@ void board_destroy(Board **board) {
 Board *board_clone(const Board *board) {
 	Board *b = board_create();
 	memcpy(b, board, sizeof(Board));
+	// accumulators belong to whoever attached them to the original
+	b->nnue = NULL;
 	history_init(b->history);
 	history_clone(b->history, board->history);
 	return b;
@@ -203,6 +209,8 @@ void board_apply_history(Board *board, History hist) {
 	board->halfmove_clock	= hist.halfmove_clock;
 	board->fullmove_counter = hist.fullmove_counter;
 	board->hash				= hist.hash;
+	board->pawn_hash		= hist.pawn_hash;
+	board->material			= hist.material;
 }
 
 bool board_from_fen(Board *board, const char *fen) {
@@ -214,7 +222,9 @@ bool board_from_fen(Board *board, const char *fen) {
 		log_error("Error parsing FEN");
 		return false;
 	};
-	board->hash = hash_board(board);
+	board->hash		 = hash_board(board);
+	board->pawn_hash = hash_pawns(board);
+	board->material	 = hash_material(board);
 	return true;
 }
 
@@ -253,6 +263,22 @@ bool board_is_square_threatened(const Board *board, Square sqr, Player player) {
 		   queen_bb & board->pieces[opponent][QUEEN] || king_bb & board->pieces[opponent][KING];
 }
 
+uint64_t board_attackers_to(const Board *board, Square sqr, uint64_t occupancies) {
+	uint64_t rooks	 = board->pieces[PLAYER_W][ROOK] | board->pieces[PLAYER_B][ROOK];
+	uint64_t bishops = board->pieces[PLAYER_W][BISHOP] | board->pieces[PLAYER_B][BISHOP];
+	uint64_t queens	 = board->pieces[PLAYER_W][QUEEN] | board->pieces[PLAYER_B][QUEEN];
+	uint64_t knights = board->pieces[PLAYER_W][KNIGHT] | board->pieces[PLAYER_B][KNIGHT];
+	uint64_t kings	 = board->pieces[PLAYER_W][KING] | board->pieces[PLAYER_B][KING];
+
+	// a pawn of one player attacks sqr from the squares a pawn of the other player on sqr attacks
+	return (bitboards_get_pawn_attacks(sqr, PLAYER_W) & board->pieces[PLAYER_B][PAWN]) |
+		   (bitboards_get_pawn_attacks(sqr, PLAYER_B) & board->pieces[PLAYER_W][PAWN]) |
+		   (bitboards_get_knight_attacks(sqr) & knights) |
+		   (bitboards_get_king_attacks(sqr) & kings) |
+		   (bitboards_get_bishop_attacks(sqr, occupancies) & (bishops | queens)) |
+		   (bitboards_get_rook_attacks(sqr, occupancies) & (rooks | queens));
+}
+
 bool board_is_check(const Board *board, Player player) {
 	if (board->pieces[player][KING] == 0)
 		return false;
@@ -20,6 +20,10 @@ VECTOR_DEFINE_TYPE(History, HistoryList, history)
 #define KING_CASTLING_W_QS_DST SQ_C1
 #define KING_CASTLING_B_KS_DST SQ_G8
 #define KING_CASTLING_B_QS_DST SQ_C8
+// the material key packs the number of pieces of every type but the king in 4 bits each
+#define MATERIAL_SHIFT(player, type) (((player) * KING + (type)) * 4)
+#define MATERIAL_COUNT(key, player, type) \
+	((int) (((key) >> MATERIAL_SHIFT(player, type)) & 0xF))
 
 struct board {
 	uint64_t	 pieces[2][6];	  // bitboards, Player and Piece used as index
@@ -32,6 +36,10 @@ struct board {
 	HistoryList *history;  // we could infer the ply from the size of the list
 
 	uint64_t hash;
+	uint64_t pawn_hash;	 // zobrist key of the pawns alone, indexes the pawn structure cache
+	uint64_t material;	 // piece counts packed with MATERIAL_SHIFT, indexes the material cache
+
+	struct nnue_state *nnue;  // accumulators kept up to date by make_move, NULL if not attached
 };
 
 Board	 *board_create(void);
@@ -52,6 +60,8 @@ Player	  board_get_occupant(const Board *board, Square sqr);
 Player	  board_get_player_turn(const Board *board);
 
 bool board_is_square_threatened(const Board *board, Square sqr, Player player);
+// pieces of both players attacking sqr, sliders are blocked by the given occupancies
+uint64_t board_attackers_to(const Board *board, Square sqr, uint64_t occupancies);
 bool board_is_check(const Board *board, Player player);
 
 // castling rights
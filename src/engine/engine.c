@@ -1,14 +1,18 @@
 #define _ISOC11_SOURCE
+#include <stdlib.h>
+#include <string.h>
 #include <threads.h>
 
 #include "bitboards.h"
 #include "board.h"
 #include "engine_mq.h"
 #include "engine_types.h"
+#include "evalcache.h"
 #include "hash.h"
 #include "log.h"
 #include "makemove.h"
 #include "movegen.h"
+#include "nnue.h"
 #include "search.h"
 #include "transposition.h"
 #include "uci.h"
@@ -19,18 +23,42 @@
 
 typedef struct engine_config {
 	unsigned int threads;
+	ParallelMode parallel_mode;
+	unsigned int probcut_margin;
+	unsigned int probcut_depth;
+	bool		 deterministic;	 // single thread and fresh tables for reproducible node counts
+	unsigned int hash_mb;
+	char		 shared_hash[UCI_PATH_LIMIT];  // shared memory segment of the TT, empty if private
+	bool		 use_nnue;
+	char		 eval_file[UCI_PATH_LIMIT];	 // network used when use_nnue is set
 } EngineConfig;
 
 typedef struct engine_state {
 	struct engine_config *config;
 	struct board		 *board;
+	struct search_stats	  stats;	   // statistics of the last search
+	bool				  searching;   // between go and bestmove
+	unsigned int		  hash_mb;	   // size of the TT, may lag behind the config
+	bool				  clear_hash;  // Clear Hash received during a search, applied once it ends
+	bool				  new_game;	   // ucinewgame received during a search, likewise
+	// segment the TT is attached to, empty while it is private
+	char				  shared_hash[UCI_PATH_LIMIT];
+	// network eval() uses, empty while it is the handcrafted evaluation
+	char				  eval_file[UCI_PATH_LIMIT];
 } EngineState;
 
 static void engine_print_info(SearchInfo *info);
+static void engine_print_stats(SearchStats *stats);
 static void engine_print_best_move(Move move);
 static void engine_isready(void);
 static void engine_uci(EngineConfig *opts);
 static void engine_print_board(void);
+static void engine_apply_hash(void);
+static void engine_apply_clear_hash(void);
+static void engine_apply_new_game(void);
+static void engine_apply_nnue(void);
+static void engine_save_hash(UciHashFile *file);
+static void engine_load_hash(UciHashFile *file);
 
 static Move ucimv_to_move(UciMove *ucimv);
 
@@ -43,12 +71,17 @@ EngineState	 state = {0};
 
 void init(void) {
 	bitboards_init();
-	ttable_init(256);
+	cfg.threads = 1;
+	cfg.hash_mb = TT_DEFAULT_MB;
+	ttable_init(cfg.hash_mb, cfg.threads);
+	state.hash_mb = cfg.hash_mb;
 	hash_init();
 	board_init(&board);
 	engmq_init();
-	state.config = &cfg;
-	state.board	 = &board;
+	cfg.probcut_margin = PROBCUT_MARGIN_DEFAULT;
+	cfg.probcut_depth  = PROBCUT_DEPTH_DEFAULT;
+	state.config	   = &cfg;
+	state.board		   = &board;
 }
 
 int main(void) {
@@ -75,6 +108,8 @@ int main(void) {
 						engine_isready();
 						break;
 					case MSG_UCI_UCINEWGAME:
+						state.new_game = true;
+						engine_apply_new_game();
 						break;
 					case MSG_UCI_POSITION: {
 						UciPosition *pos = uci.payload.position;
@@ -98,26 +133,95 @@ int main(void) {
 						// TODO: implement searchmoves
 						//  if(ucimv_list_size(go->searchmoves) > 0) {
 						//  }
-						SearchOptions opts = {.depth	 = go->depth,
-											  .nodes	 = go->nodes,
-											  .btime	 = go->btime,
-											  .wtime	 = go->wtime,
-											  .binc		 = go->binc,
-											  .winc		 = go->winc,
-											  .movetime	 = go->movetime,
-											  .movestogo = go->movestogo,
-											  .mate		 = go->mate,
-											  .infinite	 = go->infinite,
-											  .ponder	 = go->ponder};
+						SearchOptions opts = {.depth		  = go->depth,
+											  .nodes		  = go->nodes,
+											  .btime		  = go->btime,
+											  .wtime		  = go->wtime,
+											  .binc			  = go->binc,
+											  .winc			  = go->winc,
+											  .movetime		  = go->movetime,
+											  .movestogo	  = go->movestogo,
+											  .mate			  = go->mate,
+											  .infinite		  = go->infinite,
+											  .ponder		  = go->ponder,
+											  .threads		  = cfg.threads,
+											  .parallel_mode  = cfg.parallel_mode,
+											  .probcut_margin = cfg.probcut_margin,
+											  .probcut_depth  = cfg.probcut_depth};
+						// a shared table is never cleared and other processes keep writing to it,
+						// so the node counts couldnt be reproduced
+						if (cfg.deterministic && state.shared_hash[0]) {
+							printf("info string Deterministic is ignored while SharedHash %s is in "
+								   "use\n",
+								   state.shared_hash);
+							fflush(stdout);
+						} else if (cfg.deterministic) {
+							search_reset();
+							ttable_reset(cfg.threads);
+							opts.threads = 1;
+						}
 						// parse uci move into move struct
+						state.searching = true;
 						search_start(state.board, opts);
 					} break;
 					case MSG_UCI_STOP:
 						search_stop();
 						break;
 					case MSG_UCI_SETOPTION: {
-						// TODO: impement options
 						UciSetOption *opt = uci.payload.set_option;
+						switch (opt->type) {
+							case OPT_THREADS:
+								if (opt->opt.threads >= 1 &&
+									opt->opt.threads <= SEARCH_MAX_THREADS) {
+									cfg.threads = opt->opt.threads;
+								}
+								break;
+							case OPT_PARALLEL_MODE:
+								cfg.parallel_mode = opt->opt.parallel_mode == UCI_PARALLEL_ABDADA
+														? PARALLEL_ABDADA
+														: PARALLEL_SHARED_TT;
+								break;
+							case OPT_PROBCUT_MARGIN:
+								if (opt->opt.probcut_margin >= 0 &&
+									opt->opt.probcut_margin <= PROBCUT_MARGIN_MAX) {
+									cfg.probcut_margin = opt->opt.probcut_margin;
+								}
+								break;
+							case OPT_PROBCUT_DEPTH:
+								if (opt->opt.probcut_depth >= 0 &&
+									opt->opt.probcut_depth <= PROBCUT_DEPTH_MAX) {
+									cfg.probcut_depth = opt->opt.probcut_depth;
+								}
+								break;
+							case OPT_DETERMINISTIC:
+								cfg.deterministic = opt->opt.deterministic;
+								break;
+							case OPT_HASH:
+								if (opt->opt.hash_mb >= TT_MIN_MB &&
+									opt->opt.hash_mb <= TT_MAX_MB) {
+									cfg.hash_mb = opt->opt.hash_mb;
+									engine_apply_hash();
+								}
+								break;
+							case OPT_CLEAR_HASH:
+								state.clear_hash = true;
+								engine_apply_clear_hash();
+								break;
+							case OPT_SHARED_HASH:
+								strcpy(cfg.shared_hash, opt->opt.shared_hash);
+								engine_apply_hash();
+								break;
+							case OPT_USE_NNUE:
+								cfg.use_nnue = opt->opt.use_nnue;
+								engine_apply_nnue();
+								break;
+							case OPT_EVAL_FILE:
+								strcpy(cfg.eval_file, opt->opt.eval_file);
+								engine_apply_nnue();
+								break;
+							case OPT_NONE:
+								break;
+						}
 					} break;
 					case MSG_UCI_DEBUG:
 						break;
@@ -133,6 +237,15 @@ int main(void) {
 					case MSG_UCI_PRINT:
 						engine_print_board();
 						break;
+					case MSG_UCI_STATS:
+						engine_print_stats(&state.stats);
+						break;
+					case MSG_UCI_SAVEHASH:
+						engine_save_hash(uci.payload.hash_file);
+						break;
+					case MSG_UCI_LOADHASH:
+						engine_load_hash(uci.payload.hash_file);
+						break;
 					case MSG_UCI_NONE:
 						break;
 				}
@@ -145,8 +258,19 @@ int main(void) {
 						SearchInfo search_info = sm.payload.search_info;
 						engine_print_info(&search_info);
 					} break;
+					case SEARCH_MSG_STATS:
+						state.stats = sm.payload.search_stats;
+						engine_print_stats(&state.stats);
+						break;
 					case SEARCH_MSG_STOP:
 						engine_print_best_move(sm.payload.bestmove);
+						state.searching = false;
+						// Hash, Clear Hash, ucinewgame and network changes received during the
+						// search are applied now
+						engine_apply_hash();
+						engine_apply_clear_hash();
+						engine_apply_new_game();
+						engine_apply_nnue();
 						break;
 					case SEARCH_MSG_NONE:
 						break;
@@ -161,6 +285,8 @@ int main(void) {
 	thrd_join(uci_thrd, NULL);
 	log_trace("destroying search thread");
 	thrd_join(search_thrd, NULL);
+	// detaches from a shared TT, the last engine using it removes the segment
+	ttable_destroy();
 	log_trace("Shut down");
 
 	return 0;
@@ -169,12 +295,16 @@ int main(void) {
 static void engine_print_info(SearchInfo *info) {
 	assert(info != NULL);
 	assert(info->pv.data != NULL);
-	printf("info depth %d seldepth %d score cp %d nodes %lu nps %u ",
-		   info->depth,
-		   info->seldepth,
-		   info->score_cp,
-		   info->nodes,
-		   info->nps);
+	printf("info depth %d seldepth %d ", info->depth, info->seldepth);
+	int score = (int) info->score_cp;
+	if (abs(score) >= MATE_BOUND) {
+		// mate scores are reported in moves, negative when the engine is getting mated
+		int plies = CHECKMATE - abs(score);
+		printf("score mate %d ", score > 0 ? (plies + 1) / 2 : -(plies / 2));
+	} else {
+		printf("score cp %d ", score);
+	}
+	printf("nodes %lu nps %u hashfull %u ", info->nodes, info->nps, info->hashfull);
 
 	size_t pv_size = move_list_size(&info->pv);
 	printf("pv");
@@ -186,6 +316,57 @@ static void engine_print_info(SearchInfo *info) {
 	fflush(stdout);
 }
 
+#ifdef SEARCH_STATS
+static double stats_pct(uint64_t part, uint64_t total) {
+	return total ? 100.0 * part / total : 0.0;
+}
+#endif
+
+static void engine_print_stats(SearchStats *stats) {
+	assert(stats != NULL);
+#ifdef SEARCH_STATS
+	printf("info string stats nodes %lu qnodes %lu (%.1f%%)\n",
+		   stats->nodes,
+		   stats->qnodes,
+		   stats_pct(stats->qnodes, stats->nodes));
+	printf("info string stats tt probes %lu hits %lu (%.1f%%) cutoffs %lu (%.1f%%)\n",
+		   stats->tt_probes,
+		   stats->tt_hits,
+		   stats_pct(stats->tt_hits, stats->tt_probes),
+		   stats->tt_cutoffs,
+		   stats_pct(stats->tt_cutoffs, stats->tt_probes));
+	printf("info string stats beta cutoffs %lu first move %.1f%%\n",
+		   stats->beta_cutoffs,
+		   stats_pct(stats->first_move_cutoffs, stats->beta_cutoffs));
+	printf("info string stats researches aspiration %u scout %lu (%.2f%% of %lu)\n",
+		   stats->aspiration_researches,
+		   stats->scout_researches,
+		   stats_pct(stats->scout_researches, stats->scouts),
+		   stats->scouts);
+
+	// effective branching factor: nodes of an iteration over the nodes of the previous one
+	printf("info string stats ebf");
+	double	 ebf_sum	= 0;
+	uint32_t ebf_cnt	= 0;
+	uint64_t prev_nodes = stats->iteration_nodes[1];
+	for (uint32_t d = 2; d <= stats->iterations && d < MAX_DEPTH; d++) {
+		uint64_t nodes = stats->iteration_nodes[d] - stats->iteration_nodes[d - 1];
+		if (prev_nodes == 0)
+			break;
+		double ebf = (double) nodes / prev_nodes;
+		printf(" %u:%.2f", d, ebf);
+		ebf_sum += ebf;
+		ebf_cnt++;
+		prev_nodes = nodes;
+	}
+	printf(" avg %.2f\n", ebf_cnt ? ebf_sum / ebf_cnt : 0.0);
+#else
+	(void) stats;
+	printf("info string stats disabled, build with -Dsearch_stats=true\n");
+#endif
+	fflush(stdout);
+}
+
 static void engine_print_best_move(Move move) {
 	printf("bestmove %s%s\n", utils_square_to_str(move.from), utils_square_to_str(move.to));
 	fflush(stdout);
@@ -195,7 +376,29 @@ void engine_uci(EngineConfig *opts) {
 	printf("id name %s\n", ENGINE_NAME);
 	printf("id author %s\n", ENGINE_AUTHOR);
 	printf("\n");
-	printf("option name Threads value %d\n", opts->threads);
+	printf("option name Threads type spin default %d min 1 max %d\n",
+		   opts->threads,
+		   SEARCH_MAX_THREADS);
+	printf("option name ParallelMode type combo default %s var SharedTT var ABDADA\n",
+		   opts->parallel_mode == PARALLEL_ABDADA ? "ABDADA" : "SharedTT");
+	printf("option name ProbCutMargin type spin default %u min 0 max %d\n",
+		   opts->probcut_margin,
+		   PROBCUT_MARGIN_MAX);
+	printf("option name ProbCutDepth type spin default %u min 0 max %d\n",
+		   opts->probcut_depth,
+		   PROBCUT_DEPTH_MAX);
+	printf("option name Deterministic type check default %s\n",
+		   opts->deterministic ? "true" : "false");
+	printf("option name Hash type spin default %u min %d max %d\n",
+		   opts->hash_mb,
+		   TT_MIN_MB,
+		   TT_MAX_MB);
+	printf("option name Clear Hash type button\n");
+	printf("option name SharedHash type string default %s\n",
+		   opts->shared_hash[0] ? opts->shared_hash : "<empty>");
+	printf("option name UseNNUE type check default %s\n", opts->use_nnue ? "true" : "false");
+	printf("option name EvalFile type string default %s\n",
+		   opts->eval_file[0] ? opts->eval_file : "<empty>");
 	printf("uciok\n");
 	fflush(stdout);
 }
@@ -209,6 +412,120 @@ void engine_print_board(void) {
 	board_print(&board);
 }
 
+// the search threads hold no references into the TT once they are idle, so it can only be
+// reallocated between searches
+static void engine_apply_hash(void) {
+	if (state.searching)
+		return;
+	if (cfg.shared_hash[0] && strcmp(cfg.shared_hash, state.shared_hash) != 0) {
+		uint32_t size_mb;
+		if (ttable_attach_shared(cfg.shared_hash, cfg.hash_mb, hash_seed(), &size_mb)) {
+			// the process that created the segment decided its size
+			strcpy(state.shared_hash, cfg.shared_hash);
+			cfg.hash_mb	  = size_mb;
+			state.hash_mb = size_mb;
+		} else {
+			printf("info string failed to attach to shared hash %s\n", cfg.shared_hash);
+			fflush(stdout);
+			cfg.shared_hash[0] = 0;
+		}
+		return;
+	}
+	if (!cfg.shared_hash[0] && state.shared_hash[0]) {
+		state.shared_hash[0] = 0;
+		ttable_resize(cfg.hash_mb, cfg.threads);
+		state.hash_mb = cfg.hash_mb;
+		return;
+	}
+	if (state.hash_mb == cfg.hash_mb)
+		return;
+	if (state.shared_hash[0]) {
+		printf("info string Hash is fixed by the shared segment %s\n", state.shared_hash);
+		fflush(stdout);
+		cfg.hash_mb = state.hash_mb;
+		return;
+	}
+	ttable_resize(cfg.hash_mb, cfg.threads);
+	state.hash_mb = cfg.hash_mb;
+}
+
+// the workers would race the zeroing of the table, so like a resize it waits for the search to end
+static void engine_apply_clear_hash(void) {
+	if (state.searching || !state.clear_hash)
+		return;
+	state.clear_hash = false;
+	ttable_reset(cfg.threads);
+}
+
+// the workers use the killer and history tables as well as the TT. Messages are handled in
+// order, so an isready sent after ucinewgame between searches only gets its readyok once the
+// tables are clear
+static void engine_apply_new_game(void) {
+	if (state.searching || !state.new_game)
+		return;
+	state.new_game = false;
+	search_reset();
+	ttable_reset(cfg.threads);
+}
+
+// the network is only swapped between searches. Evals cached in the TT and the eval caches
+// came from the previous evaluation, so both are dropped
+static void engine_apply_nnue(void) {
+	if (state.searching)
+		return;
+	const char *wanted = cfg.use_nnue ? cfg.eval_file : "";
+	if (cfg.use_nnue && !cfg.eval_file[0]) {
+		printf("info string UseNNUE needs an EvalFile\n");
+		fflush(stdout);
+	}
+	if (strcmp(wanted, state.eval_file) == 0)
+		return;
+	// a network that fails to load changes nothing, the options go back to the evaluation in use
+	// so that it isnt retried after every search
+	if (wanted[0] && !nnue_load(wanted)) {
+		printf("info string failed to load the network %s\n", wanted);
+		fflush(stdout);
+		cfg.use_nnue = state.eval_file[0] != '\0';
+		if (cfg.use_nnue)
+			strcpy(cfg.eval_file, state.eval_file);
+		return;
+	}
+	if (!wanted[0])
+		nnue_unload();
+	strcpy(state.eval_file, wanted);
+	ttable_eval_changed(cfg.threads);
+	evalcache_clear();
+}
+
+static void engine_save_hash(UciHashFile *file) {
+	if (state.searching) {
+		printf("info string cant save the hash table while searching\n");
+	} else if (ttable_save(file->path, hash_seed())) {
+		printf("info string hash table saved to %s\n", file->path);
+	} else {
+		printf("info string failed to save the hash table to %s\n", file->path);
+	}
+	fflush(stdout);
+}
+
+static void engine_load_hash(UciHashFile *file) {
+	uint32_t size_mb;
+	if (state.searching) {
+		printf("info string cant load the hash table while searching\n");
+	} else if (ttable_load(file->path, hash_seed(), &size_mb)) {
+		// the snapshot brings its own size, a later Hash option replaces it with an empty table.
+		// Loading also detaches from a shared table
+		cfg.hash_mb			 = size_mb;
+		state.hash_mb		 = size_mb;
+		cfg.shared_hash[0]	 = 0;
+		state.shared_hash[0] = 0;
+		printf("info string hash table loaded from %s, %u MB\n", file->path, size_mb);
+	} else {
+		printf("info string failed to load the hash table from %s\n", file->path);
+	}
+	fflush(stdout);
+}
+
 static Move ucimv_to_move(UciMove *ucimv) {
 	// find the complete definition of a move to be used by make_move
 	MoveList *moves = movegen_generate(&board, board.side);
@@ -2,6 +2,9 @@
 
 #include "bits.h"
 #include "board.h"
+#include "material.h"
+#include "nnue.h"
+#include "pawn.h"
 #include "types.h"
 #include "utils.h"
 
@@ -16,7 +19,7 @@ typedef enum {
 
 const int material_values[] = {MAT_PAWN, MAT_ROOK, MAT_KNIGHT, MAT_BISHOP, MAT_QUEEN, MAT_KING};
 
-const int pawn_pos_table[] = {
+const int pawn_pos_midgame_table[] = {
 	// clang-format off
 	 0,  0,  0,  0,  0,  0,  0,  0,
 	50, 50, 50, 50, 50, 50, 50, 50,
@@ -29,7 +32,20 @@ const int pawn_pos_table[] = {
 	// clang-format on
 };
 
-const int knight_pos_table[] = {
+const int pawn_pos_endgame_table[] = {
+	// clang-format off
+	 0,  0,  0,  0,  0,  0,  0,  0,
+	80, 80, 80, 80, 80, 80, 80, 80,
+	50, 50, 50, 50, 50, 50, 50, 50,
+	30, 30, 30, 30, 30, 30, 30, 30,
+	15, 15, 15, 15, 15, 15, 15, 15,
+	 5,  5,  5,  5,  5,  5,  5,  5,
+	 0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,
+	// clang-format on
+};
+
+const int knight_pos_midgame_table[] = {
 	// clang-format off
 	-50,-40,-30,-30,-30,-30,-40,-50,
 	-40,-20,  0,  0,  0,  0,-20,-40,
@@ -42,7 +58,20 @@ const int knight_pos_table[] = {
 	// clang-format on
 };
 
-const int bishop_pos_table[] = {
+const int knight_pos_endgame_table[] = {
+	// clang-format off
+	-50,-40,-30,-30,-30,-30,-40,-50,
+	-40,-20,-10, -5, -5,-10,-20,-40,
+	-30,-10,  5, 10, 10,  5,-10,-30,
+	-30, -5, 10, 15, 15, 10, -5,-30,
+	-30, -5, 10, 15, 15, 10, -5,-30,
+	-30,-10,  5, 10, 10,  5,-10,-30,
+	-40,-20,-10, -5, -5,-10,-20,-40,
+	-50,-40,-30,-30,-30,-30,-40,-50,
+	// clang-format on
+};
+
+const int bishop_pos_midgame_table[] = {
 	// clang-format off
 	-20,-10,-10,-10,-10,-10,-10,-20,
 	-10,  0,  0,  0,  0,  0,  0,-10,
@@ -55,7 +84,20 @@ const int bishop_pos_table[] = {
 	// clang-format on
 };
 
-const int rook_pos_table[] = {
+const int bishop_pos_endgame_table[] = {
+	// clang-format off
+	-20,-10,-10,-10,-10,-10,-10,-20,
+	-10,  0,  0,  0,  0,  0,  0,-10,
+	-10,  0,  5,  5,  5,  5,  0,-10,
+	-10,  0,  5, 10, 10,  5,  0,-10,
+	-10,  0,  5, 10, 10,  5,  0,-10,
+	-10,  0,  5,  5,  5,  5,  0,-10,
+	-10,  0,  0,  0,  0,  0,  0,-10,
+	-20,-10,-10,-10,-10,-10,-10,-20,
+	// clang-format on
+};
+
+const int rook_pos_midgame_table[] = {
 	// clang-format off
 	 0,  0,  0,  0,  0,  0,  0,  0,
 	 5, 10, 10, 10, 10, 10, 10,  5,
@@ -68,7 +110,20 @@ const int rook_pos_table[] = {
 	// clang-format on
 };
 
-const int queen_pos_table[] = {
+const int rook_pos_endgame_table[] = {
+	// clang-format off
+	 0,  0,  0,  0,  0,  0,  0,  0,
+	10, 10, 10, 10, 10, 10, 10, 10,
+	 0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,
+	// clang-format on
+};
+
+const int queen_pos_midgame_table[] = {
 	// clang-format off
 	-20,-10,-10, -5, -5,-10,-10,-20,
 	-10,  0,  0,  0,  0,  0,  0,-10,
@@ -81,6 +136,19 @@ const int queen_pos_table[] = {
 	// clang-format on
 };
 
+const int queen_pos_endgame_table[] = {
+	// clang-format off
+	-20,-10,-10, -5, -5,-10,-10,-20,
+	-10,  0,  5,  5,  5,  5,  0,-10,
+	-10,  5, 10, 10, 10, 10,  5,-10,
+	 -5,  5, 10, 15, 15, 10,  5, -5,
+	 -5,  5, 10, 15, 15, 10,  5, -5,
+	-10,  5, 10, 10, 10, 10,  5,-10,
+	-10,  0,  5,  5,  5,  5,  0,-10,
+	-20,-10,-10, -5, -5,-10,-10,-20,
+	// clang-format on
+};
+
 const int king_pos_midgame_table[] = {
 	// clang-format off
 	-30,-40,-40,-50,-50,-40,-40,-30,
@@ -107,56 +175,71 @@ const int king_pos_endgame_table[] = {
 	// clang-format on
 };
 
-static int get_pos_value(PieceType type, Player player, Square sqr) {
-	Square b_sqr = (7 - utils_get_rank(sqr)) * 7 + utils_get_rank(sqr);
-	switch (type) {
-		case PAWN:
-			return player == PLAYER_W ? pawn_pos_table[sqr] : pawn_pos_table[b_sqr];
-		case KNIGHT:
-			return player == PLAYER_W ? knight_pos_table[sqr] : knight_pos_table[b_sqr];
-		case BISHOP:
-			return player == PLAYER_W ? bishop_pos_table[sqr] : bishop_pos_table[b_sqr];
-		case ROOK:
-			return player == PLAYER_W ? rook_pos_table[sqr] : rook_pos_table[b_sqr];
-		case QUEEN:
-			return player == PLAYER_W ? queen_pos_table[sqr] : queen_pos_table[b_sqr];
-		case KING:
-			return player == PLAYER_W ? king_pos_midgame_table[sqr] : king_pos_endgame_table[b_sqr];
-		default:
-			return 0;
-	}
-}
+// tables read like a diagram from a8, white squares are flipped onto them and black squares
+// index them directly
+static const Square flip[SQ_CNT] = {
+	// clang-format off
+	56, 57, 58, 59, 60, 61, 62, 63,
+	48, 49, 50, 51, 52, 53, 54, 55,
+	40, 41, 42, 43, 44, 45, 46, 47,
+	32, 33, 34, 35, 36, 37, 38, 39,
+	24, 25, 26, 27, 28, 29, 30, 31,
+	16, 17, 18, 19, 20, 21, 22, 23,
+	 8,  9, 10, 11, 12, 13, 14, 15,
+	 0,  1,  2,  3,  4,  5,  6,  7,
+	// clang-format on
+};
 
-int get_score_for_piecetype(Board* board, PieceType type, Player player) {
-	uint64_t pieces = board->pieces[player][type];
-	int		 val	= 0;
-	int		 count	= 0;
+typedef enum { MIDGAME, ENDGAME, STAGE_CNT } Stage;
 
-	while (pieces) {
-		Square sqr = bits_pop_lsb(&pieces);
-		val += get_pos_value(type, player, sqr);
-		count++;
+// indexed by PieceType
+static const int *const pos_tables[STAGE_CNT][PIECE_TYPE_CNT] = {
+	{pawn_pos_midgame_table, rook_pos_midgame_table, knight_pos_midgame_table,
+	 bishop_pos_midgame_table, queen_pos_midgame_table, king_pos_midgame_table},
+	{pawn_pos_endgame_table, rook_pos_endgame_table, knight_pos_endgame_table,
+	 bishop_pos_endgame_table, queen_pos_endgame_table, king_pos_endgame_table},
+};
+
+// adds the material and the square values of every piece of the player to both stages
+static void add_pieces(const Board* board, Player player, int sign, int score[STAGE_CNT]) {
+	for (PieceType type = PAWN; type < PIECE_TYPE_CNT; type++) {
+		uint64_t pieces = board->pieces[player][type];
+		while (pieces) {
+			Square sqr	 = bits_pop_lsb(&pieces);
+			int	   index = player == PLAYER_W ? flip[sqr] : sqr;
+			score[MIDGAME] += sign * (material_values[type] + pos_tables[MIDGAME][type][index]);
+			score[ENDGAME] += sign * (material_values[type] + pos_tables[ENDGAME][type][index]);
+		}
 	}
-	return val + count * material_values[type];
 }
 
 int eval(Board* board) {
 	Player player	= board->side;
 	Player opponent = utils_get_opponent(board->side);
 
-	int score = 0;
-	score += (get_score_for_piecetype(board, PAWN, player)) -
-			 (get_score_for_piecetype(board, PAWN, opponent));
-	score += (get_score_for_piecetype(board, KNIGHT, player)) -
-			 (get_score_for_piecetype(board, KNIGHT, opponent));
-	score += (get_score_for_piecetype(board, BISHOP, player)) -
-			 (get_score_for_piecetype(board, BISHOP, opponent));
-	score += (get_score_for_piecetype(board, ROOK, player)) -
-			 (get_score_for_piecetype(board, ROOK, opponent));
-	score += (get_score_for_piecetype(board, QUEEN, player)) -
-			 (get_score_for_piecetype(board, QUEEN, opponent));
-	score += (get_score_for_piecetype(board, KING, player)) -
-			 (get_score_for_piecetype(board, KING, opponent));
+	// known endgames replace the generic evaluation, they need both kings on the board
+	const MaterialEntry* material = material_probe(board);
+	if (material->endgame && board->pieces[PLAYER_W][KING] && board->pieces[PLAYER_B][KING]) {
+		int score = material->endgame(board, material->strong);
+		return material->strong == player ? score : -score;
+	}
+	if (nnue_active())
+		return nnue_evaluate(board);
+
+	// the phase comes from the non pawn material, which make_move keeps in the material key
+	int stages[STAGE_CNT] = {0};
+	add_pieces(board, player, 1, stages);
+	add_pieces(board, opponent, -1, stages);
+	int phase = material->phase;
+	int score = (stages[MIDGAME] * phase + stages[ENDGAME] * (MATERIAL_PHASE_MAX - phase)) /
+				MATERIAL_PHASE_MAX;
+
+	// pawn structure is cached by the pawn key, the terms depending on the pieces arent
+	const PawnEntry* structure = pawn_probe(board);
+	int				 pawns	   = structure->score + pawn_shield(board);
+	pawns += pawn_piece_terms(board, structure);
+	score += player == PLAYER_W ? pawns : -pawns;
+	score += player == PLAYER_W ? material->imbalance : -material->imbalance;
 
 	return score;
 }
@@ -2,6 +2,9 @@
 #define EVAL_H
 
 #include "../include/types.h"
+
+extern const int material_values[];  // indexed by PieceType
+
 int eval(Board *board);
 
 #endif	// EVAL_H
@@ -0,0 +1,65 @@
+#include "evalcache.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#include "eval.h"
+#include "log.h"
+
+#define EVAL_CACHE_SIZE 16384  // entries per thread, must be a power of two
+
+typedef struct {
+	uint64_t key;
+	int		 score;	 // side to move point of view, the key already includes the side
+} EvalCacheEntry;
+
+// direct mapped, a new position simply overwrites whatever shared its slot. Like the pawn and
+// material tables each search thread has its own
+static tss_t						 table_key;
+static once_flag					 table_once = ONCE_FLAG_INIT;
+static _Thread_local EvalCacheEntry *table;
+// tables of other threads cant be touched, each one clears itself once it sees a new epoch
+static atomic_uint				  epoch;
+static _Thread_local unsigned int table_epoch;
+
+static void table_key_create(void) {
+	if (tss_create(&table_key, free) != thrd_success)
+		log_error("failed to create the eval cache key");
+}
+
+static EvalCacheEntry *thread_table(void) {
+	if (table)
+		return table;
+	call_once(&table_once, table_key_create);
+	// a zero key in an empty entry is as unlikely to be hit as any other collision
+	table = calloc(EVAL_CACHE_SIZE, sizeof(EvalCacheEntry));
+	if (!table) {
+		log_error("failed to allocate the eval cache");
+		return NULL;
+	}
+	tss_set(table_key, table);
+	return table;
+}
+
+int evalcache_eval(Board *board) {
+	EvalCacheEntry *t = thread_table();
+	if (!t)
+		return eval(board);
+	unsigned int current = atomic_load_explicit(&epoch, memory_order_relaxed);
+	if (current != table_epoch) {
+		memset(t, 0, EVAL_CACHE_SIZE * sizeof(EvalCacheEntry));
+		table_epoch = current;
+	}
+	EvalCacheEntry *entry = &t[board->hash & (EVAL_CACHE_SIZE - 1)];
+	if (entry->key != board->hash) {
+		entry->key	 = board->hash;
+		entry->score = eval(board);
+	}
+	return entry->score;
+}
+
+void evalcache_clear(void) {
+	atomic_fetch_add_explicit(&epoch, 1, memory_order_relaxed);
+}
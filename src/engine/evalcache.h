@@ -0,0 +1,11 @@
+#ifndef EVALCACHE_H
+#define EVALCACHE_H
+
+#include "board.h"
+
+// eval() of the position from the cache of the calling thread, computed and stored on a miss
+int evalcache_eval(Board *board);
+// drops the cached evals of every thread, used when the evaluation itself changes
+void evalcache_clear(void);
+
+#endif	// EVALCACHE_H
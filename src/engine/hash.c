@@ -1,9 +1,8 @@
 #include "hash.h"
 
 #include <stdint.h>
-#include <stdlib.h>
-#include <time.h>
 
+#include "bits.h"
 #include "board.h"
 #include "log.h"
 #include "types.h"
@@ -14,13 +13,28 @@ static uint64_t black_to_move_key;
 static uint64_t castling_key[4];
 static uint64_t ep_key[8];	// store a key for each column
 
-// rand doesnt have a 64 bit version
+static uint64_t rand_state;
+static uint64_t seed_used;
+
+// splitmix64, the keys only depend on the seed so hashes are the same on every run
 static uint64_t rand64(void) {
-	return (uint64_t) rand() << 32 | rand();
+	uint64_t z = (rand_state += 0x9E3779B97F4A7C15ULL);
+	z		   = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z		   = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
 }
 
 void hash_init(void) {
-	srand(time(NULL));
+	hash_init_seed(HASH_SEED_DEFAULT);
+}
+
+uint64_t hash_seed(void) {
+	return seed_used;
+}
+
+void hash_init_seed(uint64_t seed) {
+	seed_used  = seed;
+	rand_state = seed;
 	for (Player p = PLAYER_W; p < PLAYER_CNT; p++) {
 		for (Square sq = SQ_A1; sq < SQ_CNT; sq++) {
 			for (PieceType pt = PAWN; pt < PIECE_TYPE_CNT; pt++) {
@@ -70,7 +84,75 @@ uint64_t hash_board(Board* board) {
 	return key;
 }
 
+uint64_t hash_pawns(Board* board) {
+	uint64_t key = 0ULL;
+	for (Player p = PLAYER_W; p < PLAYER_CNT; p++) {
+		uint64_t pawns = board->pieces[p][PAWN];
+		while (pawns) {
+			key ^= board_key[bits_pop_lsb(&pawns)][PAWN][p];
+		}
+	}
+	return key;
+}
+
+uint64_t hash_material(Board* board) {
+	uint64_t key = 0ULL;
+	for (Player p = PLAYER_W; p < PLAYER_CNT; p++) {
+		for (PieceType pt = PAWN; pt < KING; pt++) {
+			key += (uint64_t) bits_get_popcount(board->pieces[p][pt]) << MATERIAL_SHIFT(p, pt);
+		}
+	}
+	return key;
+}
+
+static PieceType promotion_type(MoveType type) {
+	switch (type) {
+		case MV_N_PROM:
+		case MV_N_PROM_CAPTURE:
+			return KNIGHT;
+		case MV_B_PROM:
+		case MV_B_PROM_CAPTURE:
+			return BISHOP;
+		case MV_R_PROM:
+		case MV_R_PROM_CAPTURE:
+			return ROOK;
+		case MV_Q_PROM:
+		case MV_Q_PROM_CAPTURE:
+			return QUEEN;
+		default:
+			return EMPTY;
+	}
+}
+
+static void hash_update_material(Board* board, Move move) {
+	Player	  opponent = utils_get_opponent(move.piece.player);
+	PieceType promoted = promotion_type(move.mv_type);
+	if (move.captured_type != EMPTY)
+		board->material -= 1ULL << MATERIAL_SHIFT(opponent, move.captured_type);
+	if (promoted != EMPTY) {
+		board->material -= 1ULL << MATERIAL_SHIFT(move.piece.player, PAWN);
+		board->material += 1ULL << MATERIAL_SHIFT(move.piece.player, promoted);
+	}
+}
+
+// only moves that move, capture or promote a pawn change the pawn key
+static void hash_update_pawns(Board* board, Move move) {
+	Player opponent = utils_get_opponent(move.piece.player);
+	if (move.piece.type == PAWN) {
+		board->pawn_hash ^= board_key[move.from][PAWN][move.piece.player];
+		if (promotion_type(move.mv_type) == EMPTY)
+			board->pawn_hash ^= board_key[move.to][PAWN][move.piece.player];
+	}
+	if (move.mv_type == MV_EN_PASSANT)
+		board->pawn_hash ^=
+			board_key[utils_ep_capture_pos(move.to, move.piece.player)][PAWN][opponent];
+	else if (move.captured_type == PAWN)
+		board->pawn_hash ^= board_key[move.to][PAWN][opponent];
+}
+
 void hash_update(Board* board, Move move, uint8_t old_castling_rights, Square old_ep) {
+	hash_update_pawns(board, move);
+	hash_update_material(board, move);
 	if (old_castling_rights != board->castling_rights) {
 		// we have no way to tell if a player lost castling rights because of a move or loss of a
 		// rook so we just reset the key
@@ -3,9 +3,17 @@
 
 #include "types.h"
 
+#define HASH_SEED_DEFAULT 0x5EED0C4E55ULL
+
 void	 hash_init(void);
+void	 hash_init_seed(uint64_t seed);
+uint64_t hash_seed(void);
 void	 hash_reset(void);
 uint64_t hash_board(Board* board);
+// key of the pawns of both players, the same position keys as hash_board restricted to pawns
+uint64_t hash_pawns(Board* board);
+// packed piece counts rather than a zobrist key, see MATERIAL_SHIFT
+uint64_t hash_material(Board* board);
 void	 hash_update(Board* board, Move move, uint8_t old_castling_rights, Square old_ep_target);
 
 #endif	// HASHING_H
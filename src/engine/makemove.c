@@ -3,6 +3,7 @@
 #include "board.h"
 #include "hash.h"
 #include "log.h"
+#include "nnue.h"
 #include "types.h"
 #include "utils.h"
 
@@ -65,7 +66,9 @@ bool make_move(Board *board, Move move) {
 							  .castling_rights	= board->castling_rights,
 							  .halfmove_clock	= board->halfmove_clock,
 							  .fullmove_counter = board->fullmove_counter,
-							  .hash				= board->hash};
+							  .hash				= board->hash,
+							  .pawn_hash		= board->pawn_hash,
+							  .material			= board->material};
 
 	switch (move.mv_type) {
 		case MV_QUIET:
@@ -175,12 +178,16 @@ bool make_move(Board *board, Move move) {
 	board->side = utils_get_opponent(hist.side);
 	history_push_back(board->history, hist);
 	hash_update(board, move, hist.castling_rights, hist.ep_target);
+	if (board->nnue)
+		nnue_push(board, move);
 	return true;
 }
 
 void unmake_move(Board *board) {
 	if (history_size(board->history) > 0) {
 		History hist = history_pop_back(board->history);
+		if (board->nnue)
+			nnue_pop(board);
 		board_apply_history(board, hist);
 	} else {
 		log_warning("Could not undo move, history is empty");
@@ -0,0 +1,244 @@
+#include "material.h"
+
+#include <stdlib.h>
+#include <threads.h>
+
+#include "bits.h"
+#include "eval.h"
+#include "log.h"
+#include "utils.h"
+
+#define MATERIAL_TABLE_SIZE 4096  // entries per thread, must be a power of two
+#define NO_KEY				(~0ULL)	 // every count is 15, which no position can reach
+#define KNOWN_WIN			10000
+#define BISHOP_PAIR			30
+#define KNIGHT_PAWN_BONUS	6	// knights gain with every own pawn above five, rooks lose
+#define ROOK_PAWN_PENALTY	12
+#define DARK_SQUARES		0xAA55AA55AA55AA55ULL  // a1 and every square of its color
+
+static const int phase_weight[] = {0, 2, 1, 1, 4};	// indexed by PieceType, kings excluded
+
+static tss_t						table_key;
+static once_flag					table_once = ONCE_FLAG_INIT;
+static _Thread_local MaterialEntry *table;
+static _Thread_local MaterialEntry	fallback;  // used uncached if the table couldnt be allocated
+
+static void table_key_create(void) {
+	if (tss_create(&table_key, free) != thrd_success)
+		log_error("failed to create the material table key");
+}
+
+// one table per search thread like the pawn table, probes need no synchronization
+static MaterialEntry *thread_table(void) {
+	if (table)
+		return table;
+	call_once(&table_once, table_key_create);
+	table = malloc(MATERIAL_TABLE_SIZE * sizeof(MaterialEntry));
+	if (!table) {
+		log_error("failed to allocate the material table");
+		return NULL;
+	}
+	for (int i = 0; i < MATERIAL_TABLE_SIZE; i++) {
+		table[i].key = NO_KEY;
+	}
+	tss_set(table_key, table);
+	return table;
+}
+
+/*
+ * Endgame evaluators
+ */
+
+static Square king_square(const Board *board, Player player) {
+	return bits_get_lsb(board->pieces[player][KING]);
+}
+
+static int min(int a, int b) {
+	return a < b ? a : b;
+}
+
+static int distance(Square a, Square b) {
+	int files = abs(utils_get_file(a) - utils_get_file(b));
+	int ranks = abs(utils_get_rank(a) - utils_get_rank(b));
+	return files > ranks ? files : ranks;
+}
+
+// 0 in the center up to 6 in the corners
+static int edge_closeness(Square sqr) {
+	int file = utils_get_file(sqr);
+	int rank = utils_get_rank(sqr);
+	return (3 - min(file, 7 - file)) + (3 - min(rank, 7 - rank));
+}
+
+static int material_of(const Board *board, Player player) {
+	int score = 0;
+	for (PieceType pt = PAWN; pt < KING; pt++) {
+		score += MATERIAL_COUNT(board->material, player, pt) * material_values[pt];
+	}
+	return score;
+}
+
+static int eval_draw(const Board *board, Player strong) {
+	(void) board;
+	(void) strong;
+	return 0;
+}
+
+// enough material to mate a lone king, it only has to be driven to the edge
+static int eval_kxk(const Board *board, Player strong) {
+	Square weak_king   = king_square(board, utils_get_opponent(strong));
+	Square strong_king = king_square(board, strong);
+	return KNOWN_WIN + material_of(board, strong) + 20 * edge_closeness(weak_king) +
+		   10 * (7 - distance(strong_king, weak_king));
+}
+
+// the material key doesnt tell the colors of the bishops, bishops of one color cant mate
+static int eval_kbbk(const Board *board, Player strong) {
+	uint64_t bishops = board->pieces[strong][BISHOP];
+	if (!(bishops & DARK_SQUARES) || !(bishops & ~DARK_SQUARES))
+		return 0;
+	return eval_kxk(board, strong);
+}
+
+// the mate can only be forced in a corner of the color of the bishop
+static int eval_kbnk(const Board *board, Player strong) {
+	Square weak_king   = king_square(board, utils_get_opponent(strong));
+	Square strong_king = king_square(board, strong);
+	Square bishop	   = bits_get_lsb(board->pieces[strong][BISHOP]);
+	bool   dark		   = (utils_get_file(bishop) + utils_get_rank(bishop)) % 2 == 0;
+	int	   corner	   = dark ? min(distance(weak_king, SQ_A1), distance(weak_king, SQ_H8))
+							  : min(distance(weak_king, SQ_H1), distance(weak_king, SQ_A8));
+	return KNOWN_WIN + material_of(board, strong) + 30 * (7 - corner) +
+		   10 * (7 - distance(strong_king, weak_king));
+}
+
+// heuristic without a bitbase: the pawn wins when the defending king is outside its square or
+// the attacking king already stands on one of its key squares
+static int eval_kpk(const Board *board, Player strong) {
+	Player weak		   = utils_get_opponent(strong);
+	Square pawn		   = bits_get_lsb(board->pieces[strong][PAWN]);
+	Square strong_king = king_square(board, strong);
+	Square weak_king   = king_square(board, weak);
+	int	   file		   = utils_get_file(pawn);
+	int	   rank		   = strong == PLAYER_W ? utils_get_rank(pawn) : 7 - utils_get_rank(pawn);
+	Square promotion   = utils_fr_to_square(file, strong == PLAYER_W ? 7 : 0);
+	int	   advance	   = strong == PLAYER_W ? 8 : -8;
+	int	   to_promote  = 7 - rank - (rank == 1);  // a pawn on its start rank can double push
+	int	   defender	   = distance(weak_king, promotion) - (board->side == weak);
+
+	if (defender > to_promote && distance(strong_king, pawn + advance) > 0)
+		return KNOWN_WIN + 10 * rank;
+	// a rook pawn is a draw once the defending king reaches the corner
+	if ((file == 0 || file == 7) && distance(weak_king, promotion) <= 1)
+		return 0;
+	int key_rank = rank >= 4 ? rank + 1 : rank + 2;
+	int king_rank =
+		strong == PLAYER_W ? utils_get_rank(strong_king) : 7 - utils_get_rank(strong_king);
+	if (file != 0 && file != 7 && abs(utils_get_file(strong_king) - file) <= 1 &&
+		king_rank >= key_rank && king_rank <= key_rank + 1)
+		return KNOWN_WIN + 10 * rank;
+	return material_values[PAWN] / 2 + 5 * rank;
+}
+
+/*
+ * Material classification
+ */
+
+static int count(uint64_t key, Player player, PieceType type) {
+	return MATERIAL_COUNT(key, player, type);
+}
+
+// every count of one side, shifted down so that it reads like a white key
+static uint64_t side_counts(uint64_t key, Player player) {
+	return key >> MATERIAL_SHIFT(player, PAWN) & ((1ULL << MATERIAL_SHIFT(PLAYER_W, KING)) - 1);
+}
+
+static bool is_bare(uint64_t key, Player player) {
+	return side_counts(key, player) == 0;
+}
+
+static int minors(uint64_t key, Player player) {
+	return count(key, player, KNIGHT) + count(key, player, BISHOP);
+}
+
+static int majors(uint64_t key, Player player) {
+	return count(key, player, ROOK) + count(key, player, QUEEN);
+}
+
+// neither side can mate: at most a single minor, or two knights against a bare king
+static bool is_insufficient(uint64_t key) {
+	for (Player p = PLAYER_W; p < PLAYER_CNT; p++) {
+		if (count(key, p, PAWN) || majors(key, p))
+			return false;
+	}
+	int white = minors(key, PLAYER_W);
+	int black = minors(key, PLAYER_B);
+	if (white <= 1 && black <= 1)
+		return true;
+	Player two = white == 2 ? PLAYER_W : PLAYER_B;
+	return white + black == 2 && count(key, two, KNIGHT) == 2;
+}
+
+static void classify_endgame(MaterialEntry *entry) {
+	uint64_t key   = entry->key;
+	entry->endgame = NULL;
+	if (is_insufficient(key)) {
+		entry->endgame = eval_draw;
+		entry->strong  = PLAYER_W;
+		return;
+	}
+	for (Player strong = PLAYER_W; strong < PLAYER_CNT; strong++) {
+		Player weak = utils_get_opponent(strong);
+		if (!is_bare(key, weak))
+			continue;
+		entry->strong = strong;
+		if (!count(key, strong, PAWN) && !majors(key, strong) &&
+			count(key, strong, KNIGHT) == 1 && count(key, strong, BISHOP) == 1) {
+			entry->endgame = eval_kbnk;
+		} else if (count(key, strong, PAWN) == 1 && !majors(key, strong) &&
+				   !minors(key, strong)) {
+			entry->endgame = eval_kpk;
+		} else if (!count(key, strong, PAWN) && !majors(key, strong) &&
+				   !count(key, strong, KNIGHT) && count(key, strong, BISHOP) >= 2) {
+			entry->endgame = eval_kbbk;
+		} else if (majors(key, strong) || count(key, strong, BISHOP) >= 2) {
+			entry->endgame = eval_kxk;
+		}
+		return;
+	}
+	// a single rook each without pawns is a draw unless the search finds something concrete
+	uint64_t lone_rook = 1ULL << MATERIAL_SHIFT(PLAYER_W, ROOK);
+	if (side_counts(key, PLAYER_W) == lone_rook && side_counts(key, PLAYER_B) == lone_rook) {
+		entry->endgame = eval_draw;
+		entry->strong  = PLAYER_W;
+	}
+}
+
+static int imbalance(uint64_t key, Player player) {
+	int pawns_above = count(key, player, PAWN) - 5;
+	int score		= count(key, player, BISHOP) >= 2 ? BISHOP_PAIR : 0;
+	score += KNIGHT_PAWN_BONUS * pawns_above * count(key, player, KNIGHT);
+	score -= ROOK_PAWN_PENALTY * pawns_above * count(key, player, ROOK);
+	return score;
+}
+
+const MaterialEntry *material_probe(const Board *board) {
+	uint64_t	   key	 = board->material;
+	MaterialEntry *t	 = thread_table();
+	MaterialEntry *entry = t ? &t[(key * 0x9E3779B97F4A7C15ULL) >> 52] : &fallback;
+	if (t && entry->key == key)
+		return entry;
+
+	entry->key		 = key;
+	entry->imbalance = imbalance(key, PLAYER_W) - imbalance(key, PLAYER_B);
+	entry->phase	 = 0;
+	for (Player p = PLAYER_W; p < PLAYER_CNT; p++) {
+		for (PieceType pt = PAWN; pt < KING; pt++) {
+			entry->phase += phase_weight[pt] * count(key, p, pt);
+		}
+	}
+	if (entry->phase > MATERIAL_PHASE_MAX)
+		entry->phase = MATERIAL_PHASE_MAX;
+	classify_endgame(entry);
+	return entry;
+}
@@ -0,0 +1,26 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <stdint.h>
+
+#include "board.h"
+#include "types.h"
+
+#define MATERIAL_PHASE_MAX 24  // phase with every piece on the board
+
+// score of a known endgame from the point of view of the strong side
+typedef int (*EndgameEval)(const Board *board, Player strong);
+
+// what only depends on the piece counts, cached by the material key
+typedef struct {
+	uint64_t	key;
+	EndgameEval endgame;	// replaces the generic evaluation, NULL if there isnt one
+	Player		strong;		// side the endgame evaluator scores for
+	int			imbalance;	// white point of view
+	int			phase;		// 0 with only kings and pawns up to MATERIAL_PHASE_MAX
+} MaterialEntry;
+
+// the entry is only valid until the next probe from the same thread
+const MaterialEntry *material_probe(const Board *board);
+
+#endif	// MATERIAL_H
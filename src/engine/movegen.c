@@ -140,6 +140,21 @@ void movegen_pawn_moves(const Board *board, Player p, MoveList *ml) {
 	}
 }
 
+void movegen_pawn_queen_promotions(const Board *board, Player p, MoveList *ml) {
+	assert(p != PLAYER_NONE);
+	uint64_t occupancies = board->occupancies[p] | board->occupancies[utils_get_opponent(p)];
+	uint64_t bb			 = board->pieces[p][PAWN] & (p == PLAYER_W ? RANK_7 : RANK_2);
+	while (bb) {
+		Square	 from	= bits_pop_lsb(&bb);
+		uint64_t pushes = bitboards_get_pawn_pushes(from, p) & ~occupancies;
+		while (pushes) {
+			Square push_sqr = bits_pop_lsb(&pushes);
+			Move   mv		= move_create(board, p, from, push_sqr, PAWN, MV_Q_PROM);
+			move_list_push_back(ml, mv);
+		}
+	}
+}
+
 void movegen_knight_moves(const Board *board, Player p, MoveList *ml) {
 	assert(p != PLAYER_NONE);
 	PieceType pt = KNIGHT;
@@ -365,3 +380,14 @@ MoveList *movegen_generate_captures(const Board *board, Player p) {
 	movegen_king_attacks(board, p, ml);
 	return ml;
 }
+
+void movegen_generate_noisy(const Board *board, Player p, MoveList *ml) {
+	move_list_clear(ml);
+	movegen_pawn_attacks(board, p, ml);
+	movegen_rook_attacks(board, p, ml);
+	movegen_bishop_attacks(board, p, ml);
+	movegen_queen_attacks(board, p, ml);
+	movegen_knight_attacks(board, p, ml);
+	movegen_king_attacks(board, p, ml);
+	movegen_pawn_queen_promotions(board, p, ml);
+}
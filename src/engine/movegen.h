@@ -11,5 +11,8 @@ MoveList *movegen_generate(const Board *board, Player p);
 MoveList *movegen_generate_moves(const Board *board, Player p);
 // generates only captures
 MoveList *movegen_generate_captures(const Board *board, Player p);
+// generates captures and quiet queen promotions into a list owned by the caller, the list is
+// cleared first so it can be reused without allocating
+void movegen_generate_noisy(const Board *board, Player p, MoveList *ml);
 
 #endif
@@ -0,0 +1,415 @@
+#include "nnue.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NNUE_X86
+#endif
+
+#include "bits.h"
+#include "log.h"
+#include "utils.h"
+
+#define MAX_CHANGES 32	// a refresh adds every piece but the kings
+
+typedef struct {
+	void		  *mapping;
+	size_t		   mapped;
+	int32_t		   scale;
+	int32_t		   output_bias;
+	const int16_t *feature_bias;
+	const int16_t *feature_weights;
+	const int8_t  *output_weights;
+} Network;
+
+// out = in + the weight rows of added - the weight rows of removed
+typedef void (*UpdateKernel)(int16_t	   *out,
+							 const int16_t *in,
+							 const int	   *added,
+							 int		    added_n,
+							 const int	   *removed,
+							 int		    removed_n);
+// clipped ReLU of both accumulators dotted with the output weights
+typedef int32_t (*OutputKernel)(const int16_t *us, const int16_t *them, const int8_t *weights);
+
+static Network		net;
+static NnueSimd		simd = NNUE_SIMD_SCALAR;
+static UpdateKernel update;
+static OutputKernel output;
+
+/*
+ * Kernels
+ */
+
+static const int16_t *weight_row(int feature) {
+	return net.feature_weights + (size_t) feature * NNUE_HIDDEN;
+}
+
+static void update_scalar(int16_t		*out,
+						  const int16_t *in,
+						  const int		*added,
+						  int			 added_n,
+						  const int		*removed,
+						  int			 removed_n) {
+	for (int i = 0; i < NNUE_HIDDEN; i++) {
+		int16_t v = in[i];
+		for (int a = 0; a < added_n; a++) {
+			v += weight_row(added[a])[i];
+		}
+		for (int r = 0; r < removed_n; r++) {
+			v -= weight_row(removed[r])[i];
+		}
+		out[i] = v;
+	}
+}
+
+static int32_t output_scalar(const int16_t *us, const int16_t *them, const int8_t *weights) {
+	int32_t sum = 0;
+	for (int i = 0; i < NNUE_HIDDEN; i++) {
+		int16_t a = us[i] < 0 ? 0 : us[i] > NNUE_QA ? NNUE_QA : us[i];
+		int16_t b = them[i] < 0 ? 0 : them[i] > NNUE_QA ? NNUE_QA : them[i];
+		sum += a * weights[i] + b * weights[NNUE_HIDDEN + i];
+	}
+	return sum;
+}
+
+#ifdef NNUE_X86
+// every register walks its slice of the accumulator through all the changes before storing it
+__attribute__((target("avx2"))) static void update_avx2(int16_t		*out,
+														 const int16_t *in,
+														 const int		*added,
+														 int			 added_n,
+														 const int		*removed,
+														 int			 removed_n) {
+	for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+		__m256i v = _mm256_loadu_si256((const __m256i *) (in + i));
+		for (int a = 0; a < added_n; a++) {
+			const __m256i *row = (const __m256i *) (weight_row(added[a]) + i);
+			v				   = _mm256_add_epi16(v, _mm256_loadu_si256(row));
+		}
+		for (int r = 0; r < removed_n; r++) {
+			const __m256i *row = (const __m256i *) (weight_row(removed[r]) + i);
+			v				   = _mm256_sub_epi16(v, _mm256_loadu_si256(row));
+		}
+		_mm256_store_si256((__m256i *) (out + i), v);
+	}
+}
+
+// activations are packed to 8 bits so maddubs multiplies 32 of them per instruction, the
+// clipped values cant saturate its 16 bit pair sums
+__attribute__((target("avx2"))) static int32_t output_avx2(const int16_t *us,
+														   const int16_t *them,
+														   const int8_t	 *weights) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i ceil = _mm256_set1_epi16(NNUE_QA);
+	const __m256i ones = _mm256_set1_epi16(1);
+	__m256i		  sum  = zero;
+	for (int side = 0; side < PLAYER_CNT; side++) {
+		const int16_t *acc = side == 0 ? us : them;
+		const int8_t  *w   = weights + side * NNUE_HIDDEN;
+		for (int i = 0; i < NNUE_HIDDEN; i += 32) {
+			__m256i lo = _mm256_loadu_si256((const __m256i *) (acc + i));
+			__m256i hi = _mm256_loadu_si256((const __m256i *) (acc + i + 16));
+			lo		   = _mm256_min_epi16(_mm256_max_epi16(lo, zero), ceil);
+			hi		   = _mm256_min_epi16(_mm256_max_epi16(hi, zero), ceil);
+			// packing works per 128 bit lane, the permute restores the order of the weights
+			__m256i act	 = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+			__m256i prod = _mm256_maddubs_epi16(act, _mm256_loadu_si256((const __m256i *) (w + i)));
+			sum			 = _mm256_add_epi32(sum, _mm256_madd_epi16(prod, ones));
+		}
+	}
+	__m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+	s		  = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+	s		  = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+	return _mm_cvtsi128_si32(s);
+}
+
+__attribute__((target("sse4.1"))) static void update_sse41(int16_t	   *out,
+														   const int16_t *in,
+														   const int	 *added,
+														   int			  added_n,
+														   const int	 *removed,
+														   int			  removed_n) {
+	for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (in + i));
+		for (int a = 0; a < added_n; a++) {
+			const __m128i *row = (const __m128i *) (weight_row(added[a]) + i);
+			v				   = _mm_add_epi16(v, _mm_loadu_si128(row));
+		}
+		for (int r = 0; r < removed_n; r++) {
+			const __m128i *row = (const __m128i *) (weight_row(removed[r]) + i);
+			v				   = _mm_sub_epi16(v, _mm_loadu_si128(row));
+		}
+		_mm_store_si128((__m128i *) (out + i), v);
+	}
+}
+
+__attribute__((target("sse4.1"))) static int32_t output_sse41(const int16_t *us,
+															  const int16_t *them,
+															  const int8_t	*weights) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i ceil = _mm_set1_epi16(NNUE_QA);
+	const __m128i ones = _mm_set1_epi16(1);
+	__m128i		  sum  = zero;
+	for (int side = 0; side < PLAYER_CNT; side++) {
+		const int16_t *acc = side == 0 ? us : them;
+		const int8_t  *w   = weights + side * NNUE_HIDDEN;
+		for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+			__m128i lo	 = _mm_loadu_si128((const __m128i *) (acc + i));
+			__m128i hi	 = _mm_loadu_si128((const __m128i *) (acc + i + 8));
+			lo			 = _mm_min_epi16(_mm_max_epi16(lo, zero), ceil);
+			hi			 = _mm_min_epi16(_mm_max_epi16(hi, zero), ceil);
+			__m128i act	 = _mm_packus_epi16(lo, hi);
+			__m128i prod = _mm_maddubs_epi16(act, _mm_loadu_si128((const __m128i *) (w + i)));
+			sum			 = _mm_add_epi32(sum, _mm_madd_epi16(prod, ones));
+		}
+	}
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+	return _mm_cvtsi128_si32(sum);
+}
+#endif
+
+static bool simd_supported(NnueSimd level) {
+	switch (level) {
+		case NNUE_SIMD_SCALAR:
+			return true;
+#ifdef NNUE_X86
+		case NNUE_SIMD_SSE41:
+			return __builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("ssse3");
+		case NNUE_SIMD_AVX2:
+			return __builtin_cpu_supports("avx2");
+#endif
+		default:
+			return false;
+	}
+}
+
+bool nnue_use_simd(NnueSimd level) {
+	if (!simd_supported(level))
+		return false;
+	simd = level;
+	switch (level) {
+#ifdef NNUE_X86
+		case NNUE_SIMD_AVX2:
+			update = update_avx2;
+			output = output_avx2;
+			break;
+		case NNUE_SIMD_SSE41:
+			update = update_sse41;
+			output = output_sse41;
+			break;
+#endif
+		default:
+			update = update_scalar;
+			output = output_scalar;
+			break;
+	}
+	return true;
+}
+
+NnueSimd nnue_simd(void) {
+	return simd;
+}
+
+/*
+ * Network
+ */
+
+bool nnue_load(const char *path) {
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		log_error("failed to open network %s", path);
+		return false;
+	}
+	struct stat st;
+	size_t		weights	 = (size_t) NNUE_FEATURES * NNUE_HIDDEN;
+	size_t		expected = sizeof(NnueHeader) + NNUE_HIDDEN * sizeof(int16_t) +
+					   weights * sizeof(int16_t) + 2 * NNUE_HIDDEN + sizeof(int32_t);
+	if (fstat(fd, &st) != 0 || (size_t) st.st_size != expected) {
+		log_error("%s is not a network of this architecture", path);
+		close(fd);
+		return false;
+	}
+	// the weights are paged in on demand and shared with every other process using the file
+	void *file = mmap(NULL, expected, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (file == MAP_FAILED) {
+		log_error("failed to map network %s", path);
+		return false;
+	}
+	NnueHeader header;
+	memcpy(&header, file, sizeof(header));
+	if (memcmp(header.magic, NNUE_MAGIC, sizeof(NNUE_MAGIC)) != 0 ||
+		header.version != NNUE_VERSION || header.features != NNUE_FEATURES ||
+		header.hidden != NNUE_HIDDEN || header.scale <= 0) {
+		log_error("network %s doesnt match this engine", path);
+		munmap(file, expected);
+		return false;
+	}
+
+	nnue_unload();
+	const char *data	= (const char *) file + sizeof(NnueHeader);
+	net.mapping			= file;
+	net.mapped			= expected;
+	net.scale			= header.scale;
+	net.feature_bias	= (const int16_t *) data;
+	net.feature_weights = net.feature_bias + NNUE_HIDDEN;
+	net.output_weights	= (const int8_t *) (net.feature_weights + weights);
+	memcpy(&net.output_bias, net.output_weights + 2 * NNUE_HIDDEN, sizeof(int32_t));
+
+	NnueSimd best = NNUE_SIMD_AVX2;
+	while (!nnue_use_simd(best)) {
+		best--;
+	}
+	static const char *simd_names[] = {"scalar", "SSE4.1", "AVX2"};
+	log_info("Loaded network %s, %s kernels", path, simd_names[best]);
+	return true;
+}
+
+void nnue_unload(void) {
+	if (net.mapping)
+		munmap(net.mapping, net.mapped);
+	memset(&net, 0, sizeof(net));
+}
+
+bool nnue_active(void) {
+	return net.mapping != NULL;
+}
+
+/*
+ * Accumulators
+ */
+
+// features are seen from the perspective, black flips the board so both sides see their own
+// pieces moving up the board
+static int feature(Player perspective, Square king, Piece piece, Square sqr) {
+	if (perspective == PLAYER_B) {
+		king ^= 56;
+		sqr ^= 56;
+	}
+	int kind = (piece.player != perspective) * (NNUE_KINDS / 2) + piece.type;
+	return (king * NNUE_KINDS + kind) * SQ_CNT + sqr;
+}
+
+static void refresh_perspective(const Board *board, Player perspective, int16_t *out) {
+	uint64_t kings = board->pieces[perspective][KING];
+	int		 added[MAX_CHANGES];
+	int		 added_n = 0;
+	if (kings) {
+		Square king = bits_get_lsb(kings);
+		for (Player p = PLAYER_W; p < PLAYER_CNT; p++) {
+			for (PieceType pt = PAWN; pt < KING; pt++) {
+				uint64_t pieces = board->pieces[p][pt];
+				while (pieces && added_n < MAX_CHANGES) {
+					Square sqr		 = bits_pop_lsb(&pieces);
+					Piece  piece	 = {.type = pt, .player = p};
+					added[added_n++] = feature(perspective, king, piece, sqr);
+				}
+			}
+		}
+	}
+	update(out, net.feature_bias, added, added_n, NULL, 0);
+}
+
+void nnue_refresh(const Board *board, NnueAccumulator *acc) {
+	refresh_perspective(board, PLAYER_W, acc->values[PLAYER_W]);
+	refresh_perspective(board, PLAYER_B, acc->values[PLAYER_B]);
+}
+
+NnueState *nnue_state_create(void) {
+	NnueState *state = aligned_alloc(_Alignof(NnueState), sizeof(NnueState));
+	if (!state)
+		log_error("failed to allocate NNUE accumulators");
+	return state;
+}
+
+void nnue_state_destroy(NnueState **state) {
+	if (state && *state) {
+		free(*state);
+		*state = NULL;
+	}
+}
+
+void nnue_attach(Board *board, NnueState *state) {
+	board->nnue = state;
+	state->top	= 0;
+	nnue_refresh(board, &state->stack[0]);
+}
+
+void nnue_detach(Board *board) {
+	board->nnue = NULL;
+}
+
+void nnue_push(Board *board, Move move) {
+	NnueState *state = board->nnue;
+	assert(state->top + 1 < NNUE_STACK);
+	const NnueAccumulator *prev	 = &state->stack[state->top];
+	NnueAccumulator		  *next	 = &state->stack[++state->top];
+	Player				   mover = move.piece.player;
+	Player				   enemy = utils_get_opponent(mover);
+
+	for (Player persp = PLAYER_W; persp < PLAYER_CNT; persp++) {
+		// the king is part of every feature of its own perspective
+		if ((move.piece.type == KING && persp == mover) || !board->pieces[persp][KING]) {
+			refresh_perspective(board, persp, next->values[persp]);
+			continue;
+		}
+		Square king = bits_get_lsb(board->pieces[persp][KING]);
+		int	   added[3], removed[3];
+		int	   added_n = 0, removed_n = 0;
+		if (move.piece.type != KING) {
+			// promotions leave a different piece on the target square
+			PieceType landed	 = board_get_piece_type(board, move.to);
+			Piece	  moved		 = {.type = landed, .player = mover};
+			removed[removed_n++] = feature(persp, king, move.piece, move.from);
+			added[added_n++]	 = feature(persp, king, moved, move.to);
+		}
+		if (move.mv_type == MV_EN_PASSANT) {
+			Square captured		 = mover == PLAYER_W ? move.to - 8 : move.to + 8;
+			Piece  pawn			 = {.type = PAWN, .player = enemy};
+			removed[removed_n++] = feature(persp, king, pawn, captured);
+		} else if (move.captured_type != EMPTY) {
+			Piece captured		 = {.type = move.captured_type, .player = enemy};
+			removed[removed_n++] = feature(persp, king, captured, move.to);
+		}
+		if (move.mv_type == MV_KS_CASTLE || move.mv_type == MV_QS_CASTLE) {
+			bool   ks	= move.mv_type == MV_KS_CASTLE;
+			Square from = ks ? ROOK_CASTLING_W_KS_SRC : ROOK_CASTLING_W_QS_SRC;
+			Square to	= ks ? ROOK_CASTLING_W_KS_DST : ROOK_CASTLING_W_QS_DST;
+			// black castles on the mirrored squares
+			if (mover == PLAYER_B) {
+				from ^= 56;
+				to ^= 56;
+			}
+			Piece rook			 = {.type = ROOK, .player = mover};
+			removed[removed_n++] = feature(persp, king, rook, from);
+			added[added_n++]	 = feature(persp, king, rook, to);
+		}
+		update(next->values[persp], prev->values[persp], added, added_n, removed, removed_n);
+	}
+}
+
+void nnue_pop(Board *board) {
+	assert(board->nnue->top > 0);
+	board->nnue->top--;
+}
+
+int nnue_evaluate(const Board *board) {
+	NnueAccumulator		   scratch;
+	const NnueAccumulator *acc = &scratch;
+	if (board->nnue)
+		acc = &board->nnue->stack[board->nnue->top];
+	else
+		nnue_refresh(board, &scratch);
+	Player	us	= board->side;
+	int32_t sum = output(acc->values[us], acc->values[utils_get_opponent(us)], net.output_weights);
+	return (int64_t) (net.output_bias + sum) * net.scale / (NNUE_QA * NNUE_QB);
+}
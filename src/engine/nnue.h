@@ -0,0 +1,76 @@
+#ifndef NNUE_H
+#define NNUE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "board.h"
+#include "types.h"
+
+// HalfKP input layer: for each perspective a feature is its own king square combined with any
+// other piece and its square. The accumulators are followed by a clipped ReLU and a single
+// output neuron that sees the side to move first
+#define NNUE_KINDS	  10  // pawn to queen of both colors
+#define NNUE_FEATURES (SQ_CNT * NNUE_KINDS * SQ_CNT)
+#define NNUE_HIDDEN	  256
+#define NNUE_QA		  127  // activations are clipped to [0, NNUE_QA]
+#define NNUE_QB		  64   // output weights are quantized with this factor
+#define NNUE_STACK	  130  // accumulators one per ply from the root, the search stays below
+
+/*
+ * Network file, all values little endian:
+ *   NnueHeader (64 bytes)
+ *   int16 feature_bias[NNUE_HIDDEN]
+ *   int16 feature_weights[NNUE_FEATURES][NNUE_HIDDEN]
+ *   int8  output_weights[2 * NNUE_HIDDEN]  side to move accumulator first
+ *   int32 output_bias
+ * The score is (output_bias + sum) * scale / (NNUE_QA * NNUE_QB) centipawns.
+ */
+#define NNUE_MAGIC	 "CHESSNN"
+#define NNUE_VERSION 1
+
+typedef struct {
+	char	 magic[8];
+	uint32_t version;
+	uint32_t features;	// must match NNUE_FEATURES
+	uint32_t hidden;	// must match NNUE_HIDDEN
+	int32_t	 scale;
+	uint8_t	 reserved[40];
+} NnueHeader;
+
+typedef enum { NNUE_SIMD_SCALAR, NNUE_SIMD_SSE41, NNUE_SIMD_AVX2 } NnueSimd;
+
+typedef struct {
+	_Alignas(64) int16_t values[PLAYER_CNT][NNUE_HIDDEN];  // indexed by perspective
+} NnueAccumulator;
+
+typedef struct nnue_state {
+	NnueAccumulator stack[NNUE_STACK];
+	int				top;  // accumulator of the current position
+} NnueState;
+
+// maps the network, the previous one is only replaced if the file is valid. Networks are
+// swapped between searches only, evaluations in flight read the mapping
+bool nnue_load(const char *path);
+void nnue_unload(void);
+// true once a network is loaded, eval() uses it from then on
+bool nnue_active(void);
+// the best kernels the cpu supports are picked at load, a lower level can be forced
+bool	 nnue_use_simd(NnueSimd simd);
+NnueSimd nnue_simd(void);
+
+NnueState *nnue_state_create(void);
+void	   nnue_state_destroy(NnueState **state);
+// binds the accumulators to the board, make_move and unmake_move keep them up to date until
+// they are detached
+void nnue_attach(Board *board, NnueState *state);
+void nnue_detach(Board *board);
+// called by make_move once the move was made, and unmake_move before restoring the board
+void nnue_push(Board *board, Move move);
+void nnue_pop(Board *board);
+// accumulators computed from scratch
+void nnue_refresh(const Board *board, NnueAccumulator *acc);
+// side to move point of view, refreshes on the fly if the board has no accumulators
+int nnue_evaluate(const Board *board);
+
+#endif	// NNUE_H
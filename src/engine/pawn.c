@@ -0,0 +1,176 @@
+#include "pawn.h"
+
+#include <stdlib.h>
+#include <threads.h>
+
+#include "bits.h"
+#include "log.h"
+#include "utils.h"
+
+#define PAWN_TABLE_SIZE 16384  // entries per thread, must be a power of two
+#define FILE_A_BB		0x0101010101010101ULL
+#define FILE_H_BB		(FILE_A_BB << 7)
+#define ISOLATED		10
+#define DOUBLED			10
+#define BACKWARD		8
+#define SHIELD_NEAR		10	// pawn right in front of the king
+#define SHIELD_FAR		5	// pawn two ranks in front of the king
+#define KNIGHT_OUTPOST	20	// knight on ranks 4 to 6 no pawn can chase, supported by a pawn
+
+static const int passed_bonus[8] = {0, 5, 10, 20, 35, 60, 100, 0};  // by relative rank
+static const int free_passer[8]	 = {0, 0, 5, 10, 15, 25, 40, 0};	// stop square empty as well
+
+// every search thread gets its own table so probes need no synchronization. The pointer is
+// cached in a thread local, the tss key only frees the table when the thread exits
+static tss_t					table_key;
+static once_flag				table_once = ONCE_FLAG_INIT;
+static _Thread_local PawnEntry *table;
+static _Thread_local PawnEntry	fallback;  // used uncached if the table couldnt be allocated
+
+static void table_key_create(void) {
+	if (tss_create(&table_key, free) != thrd_success)
+		log_error("failed to create the pawn table key");
+}
+
+static PawnEntry *thread_table(void) {
+	if (table)
+		return table;
+	call_once(&table_once, table_key_create);
+	// an empty table is valid, the zero key belongs to positions without pawns which score zero
+	table = calloc(PAWN_TABLE_SIZE, sizeof(PawnEntry));
+	if (!table) {
+		log_error("failed to allocate the pawn table");
+		return NULL;
+	}
+	tss_set(table_key, table);
+	return table;
+}
+
+// every square in front of the given ones from the point of view of the player, exclusive
+static uint64_t front_span(uint64_t bb, Player player) {
+	if (player == PLAYER_W) {
+		bb <<= 8;
+		bb |= bb << 8;
+		bb |= bb << 16;
+		bb |= bb << 32;
+	} else {
+		bb >>= 8;
+		bb |= bb >> 8;
+		bb |= bb >> 16;
+		bb |= bb >> 32;
+	}
+	return bb;
+}
+
+static uint64_t adjacent_files(uint64_t bb) {
+	return ((bb << 1) & ~FILE_A_BB) | ((bb >> 1) & ~FILE_H_BB);
+}
+
+static uint64_t pawn_attacks(uint64_t pawns, Player player) {
+	if (player == PLAYER_W)
+		return ((pawns << 7) & ~FILE_H_BB) | ((pawns << 9) & ~FILE_A_BB);
+	return ((pawns >> 9) & ~FILE_H_BB) | ((pawns >> 7) & ~FILE_A_BB);
+}
+
+static int relative_rank(Square sqr, Player player) {
+	return player == PLAYER_W ? utils_get_rank(sqr) : 7 - utils_get_rank(sqr);
+}
+
+static int evaluate_player(const Board *board, Player player, PawnEntry *entry) {
+	Player	 opponent  = utils_get_opponent(player);
+	uint64_t own	   = board->pieces[player][PAWN];
+	uint64_t enemy	   = board->pieces[opponent][PAWN];
+	uint64_t enemy_att = pawn_attacks(enemy, opponent);
+	int		 score	   = 0;
+
+	entry->attack_span[player] = front_span(pawn_attacks(own, player), player) |
+								 pawn_attacks(own, player);
+	entry->passed[player]	   = 0;
+
+	for (int file = 0; file < 8; file++) {
+		int count = bits_get_popcount(own & (FILE_A_BB << file));
+		if (count > 1)
+			score -= DOUBLED * (count - 1);
+	}
+
+	uint64_t pawns = own;
+	while (pawns) {
+		Square	 sqr	= bits_pop_lsb(&pawns);
+		uint64_t bb		= 1ULL << sqr;
+		uint64_t file	= FILE_A_BB << utils_get_file(sqr);
+		uint64_t ahead	= front_span(bb, player);
+		uint64_t stop	= player == PLAYER_W ? bb << 8 : bb >> 8;
+		uint64_t behind = file & ~ahead;  // own rank and everything behind it
+
+		if (!(enemy & (ahead | adjacent_files(ahead)))) {
+			entry->passed[player] |= bb;
+			score += passed_bonus[relative_rank(sqr, player)];
+		}
+		if (!(own & adjacent_files(file))) {
+			score -= ISOLATED;
+		} else if (!(own & adjacent_files(behind)) && (stop & enemy_att)) {
+			// no pawn can come to its support and advancing loses it
+			score -= BACKWARD;
+		}
+	}
+	return score;
+}
+
+const PawnEntry *pawn_probe(const Board *board) {
+	PawnEntry *t	 = thread_table();
+	PawnEntry *entry = t ? &t[board->pawn_hash & (PAWN_TABLE_SIZE - 1)] : &fallback;
+	if (t && entry->key == board->pawn_hash)
+		return entry;
+	entry->key	 = board->pawn_hash;
+	entry->score = evaluate_player(board, PLAYER_W, entry);
+	entry->score -= evaluate_player(board, PLAYER_B, entry);
+	return entry;
+}
+
+static int shield(const Board *board, Player player) {
+	uint64_t king = board->pieces[player][KING];
+	if (!king)
+		return 0;
+	Square sqr = bits_get_lsb(king);
+	// only a king that stayed on its back ranks next to the corner is sheltered by its pawns
+	int file = utils_get_file(sqr);
+	if (relative_rank(sqr, player) > 1 || (file > 2 && file < 5))
+		return 0;
+	uint64_t near = player == PLAYER_W ? king << 8 : king >> 8;
+	near |= adjacent_files(near);
+	uint64_t far   = player == PLAYER_W ? near << 8 : near >> 8;
+	uint64_t pawns = board->pieces[player][PAWN];
+	return SHIELD_NEAR * bits_get_popcount(pawns & near) +
+		   SHIELD_FAR * bits_get_popcount(pawns & far);
+}
+
+int pawn_shield(const Board *board) {
+	return shield(board, PLAYER_W) - shield(board, PLAYER_B);
+}
+
+static int piece_terms(const Board *board, const PawnEntry *entry, Player player) {
+	Player	 opponent = utils_get_opponent(player);
+	uint64_t occupied = board->occupancies[PLAYER_W] | board->occupancies[PLAYER_B];
+	int		 score	  = 0;
+
+	uint64_t passed = entry->passed[player];
+	while (passed) {
+		Square	 sqr  = bits_pop_lsb(&passed);
+		uint64_t stop = player == PLAYER_W ? 1ULL << sqr << 8 : 1ULL << sqr >> 8;
+		if (!(stop & occupied))
+			score += free_passer[relative_rank(sqr, player)];
+	}
+
+	uint64_t support = pawn_attacks(board->pieces[player][PAWN], player);
+	uint64_t knights = board->pieces[player][KNIGHT] & support & ~entry->attack_span[opponent];
+	while (knights) {
+		int rank = relative_rank(bits_pop_lsb(&knights), player);
+		if (rank >= 3 && rank <= 5)
+			score += KNIGHT_OUTPOST;
+	}
+	return score;
+}
+
+int pawn_piece_terms(const Board *board, const PawnEntry *entry) {
+	return piece_terms(board, entry, PLAYER_W) - piece_terms(board, entry, PLAYER_B);
+}
@@ -0,0 +1,25 @@
+#ifndef PAWN_H
+#define PAWN_H
+
+#include <stdint.h>
+
+#include "board.h"
+#include "types.h"
+
+// pawn structure terms only depend on the pawns, so they are cached by the pawn key
+typedef struct {
+	uint64_t key;
+	uint64_t passed[PLAYER_CNT];
+	uint64_t attack_span[PLAYER_CNT];  // squares the pawns attack now or after advancing
+	int		 score;					   // white point of view
+} PawnEntry;
+
+// the entry is only valid until the next probe from the same thread
+const PawnEntry *pawn_probe(const Board *board);
+// bonus for the pawns in front of a castled king, white point of view
+int pawn_shield(const Board *board);
+// passed pawns free to advance and knight outposts, which need the pieces as well as the
+// cached pawn structure. White point of view
+int pawn_piece_terms(const Board *board, const PawnEntry *entry);
+
+#endif	// PAWN_H
@@ -1,38 +1,89 @@
 #include "search.h"
 
-#include <limits.h>
+#include <stdatomic.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <sys/time.h>
 #include <threads.h>
 
 #include "board.h"
 #include "engine_mq.h"
 #include "eval.h"
+#include "evalcache.h"
 #include "log.h"
 #include "makemove.h"
 #include "movegen.h"
+#include "nnue.h"
 #include "search_types.h"
+#include "see.h"
 #include "transposition.h"
 #include "types.h"
 
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
 
-#define INF					(INT_MAX - 100000)
-#define CHECKMATE			(INF - 1000000)
-#define MAX_DEPTH			64
-#define TIME_CHECK_INTERVAL 0x4000
+#define MAX_MOVES			256
+#define MAX_PLY				128	 // quiescence can go past MAX_DEPTH
+#define NODE_BATCH			512	 // nodes counted per thread before updating the shared count
 #define TIME_BUFFER			50	// time in ms
-#define ASPIRATION_WINDOW	50	// centipawns
-
+#define HISTORY_DECAY		8	 // history scores are divided by this between searches
+#define ASPIRATION_WINDOW	50	 // centipawns
+#define ASPIRATION_MAX		1000  // past this delta the window is opened fully
+#define DELTA_MARGIN		200	 // centipawns a capture may gain on top of the captured material
+#define ABDADA_TABLE_SIZE	(1 << 15)
+#define ABDADA_MIN_DEPTH	3  // below this depth deferring moves costs more than it saves
+
+// statistics cost a few increments per node, release builds leave them out
+#ifdef SEARCH_STATS
+#define STATS_INC(w, counter) ((w)->info.stats.counter++)
+#else
+#define STATS_INC(w, counter) ((void) 0)
+#endif
+
+// state of one search, the UCI search uses search_ctx while search_run keeps its own
 typedef struct search_context {
-	struct search_info	 *info;
 	struct board		 *board;
 	struct search_options opts;
 	mtx_t				  lock;
 	cnd_t				  cond;
-	bool				  searching;
+	atomic_bool			  searching;
+	_Atomic uint64_t	  nodes;  // nodes flushed by every thread, checked against the node limit
+	MoveList			  root_pv;
+	uint64_t			  reported_nodes;
+	struct search_worker *workers;	// opts.threads workers
+	bool				  report;	// send info messages to the engine thread
 } SearchContext;
 
+// state owned by a single search thread, worker 0 is the main thread and the only one reporting
+typedef struct search_worker {
+	int			   id;
+	SearchContext *ctx;
+	thrd_t		   thread;
+	Board		  *board;
+	SearchInfo	   info;
+	uint32_t	   nodes_unflushed;
+	Move		   pv_table[MAX_DEPTH][MAX_DEPTH];
+	uint8_t		   pv_length[MAX_DEPTH];
+	Move		   killer_moves[MAX_DEPTH][2];
+	int			   history_heuristic[PLAYER_CNT][SQ_CNT][SQ_CNT];  // player, from, to
+	MoveList	   qs_moves[MAX_PLY];  // reused by quiescence to avoid allocating at every node
+	NnueState	  *nnue;			   // board accumulators, allocated lazily for NNUE
+	uint64_t	   pool_epoch;		   // last search a helper woke up for
+} SearchWorker;
+
+// helpers are started once and wait between searches, so the pawn, material and eval caches of
+// their threads stay warm from one search to the next
+typedef struct {
+	mtx_t	 lock;
+	cnd_t	 wake;	   // helpers wait here for the next search
+	cnd_t	 done;	   // the main thread waits here for the helpers to finish
+	uint64_t epoch;	   // bumped for every search
+	uint32_t started;  // helper threads created so far, worker ids 1 to started
+	uint32_t active;   // helpers taking part in the current search, ids 1 to active
+	uint32_t running;  // active helpers that havent finished yet
+	bool	 shutdown;
+} HelperPool;
+
 static const int mvv_lva[PIECE_TYPE_CNT][PIECE_TYPE_CNT] = {
 	// Victim:  P    N    B    R    Q    K
 	{105, 205, 305, 405, 505, 605}, // Attacker: P
@@ -52,227 +103,376 @@ typedef enum {
 	SCORE_TT			= 20000,
 } ScoreType;
 
-int	 search(int			   depth,
-			int			   alpha,
-			int			   beta,
-			int			   ply,
-			Board		  *board,
-			SearchOptions *opts,
-			SearchInfo	  *info,
-			bool		   is_pv);
-int	 quiescence(Board *board, int alpha, int beta, int ply, SearchOptions *opts, SearchInfo *info);
-void iter_deepening(struct board *board, struct search_options *opts);
-bool search_should_stop(void);
-
-static bool is_repetition(Board *board);
-static int	mvv_lva_compare(const void *x, const void *y);
-static void score_move(Move *move, int ply, Player side, TEntry *tte);
-static int	compare_move(const void *x, const void *y);
-static void sort_moves(MoveList *moves, TEntry *tte, int ply, Player side);
-static void gstop_cond_eval(SearchOptions *options, SearchInfo *info);
+int	 search(SearchWorker *w, int depth, int alpha, int beta, int ply, bool is_pv);
+int	 quiescence(SearchWorker *w, int alpha, int beta, int ply);
+static bool probcut(SearchWorker *w, int depth, int beta, int ply, int static_eval, int *out_score);
+void iter_deepening(SearchWorker *w);
+static bool should_stop(const SearchContext *ctx);
+static void stop(SearchContext *ctx);
+
+static bool		is_repetition(Board *board);
+static int		mvv_lva_compare(const void *x, const void *y);
+static void		score_move(SearchWorker *w, Move *move, int ply, TEntry *tte);
+static int		compare_move(const void *x, const void *y);
+static void		sort_moves(SearchWorker *w, MoveList *moves, TEntry *tte, int ply);
+static void		score_noisy_moves(MoveList *moves, TEntry *tte);
+static Move		pick_move(MoveList *moves, size_t i);
+static void		gstop_cond_eval(SearchWorker *w);
+static void		count_node(SearchWorker *w);
+static void		flush_nodes(SearchWorker *w);
+static void		age_search_state(SearchWorker *w);
+static void		root_pv_fallback(SearchContext *ctx);
+static Move		tt_move_find(Board *board, uint16_t packed);
+static uint64_t search_nodes(const SearchContext *ctx);
+
+static int	helper_thread(void *arg);
+static void helpers_start(void);
+static void helpers_join(void);
+static void helpers_shutdown(void);
+
+static uint64_t abdada_move_key(const Board *board, Move move);
+static bool		abdada_is_busy(uint64_t move_key);
+static void		abdada_set_busy(uint64_t move_key);
+static void		abdada_clear_busy(uint64_t move_key);
 
 static uint32_t timeval_to_ms(struct timeval tv);
 static uint32_t time_now(void);
 static uint32_t search_calculate_time_budget(const SearchOptions *opts, Player p);
 
 static int send_msg_stop(MoveList *pv);
-static int send_msg_info(SearchInfo *info);
+static int send_msg_info(SearchContext *ctx, SearchInfo *info);
+#ifdef SEARCH_STATS
+static int send_msg_stats(SearchContext *ctx);
+#endif
 
-Move		  pv_table[MAX_DEPTH][MAX_DEPTH];
-uint8_t		  pv_length[MAX_DEPTH];
-Move		  killer_moves[MAX_DEPTH][2];
-int			  history_heuristic[PLAYER_CNT][SQ_CNT][SQ_CNT];  // player, from, to
-MoveList	  root_pv;
-SearchContext search_ctx			 = {0};
-uint32_t	  nodes_since_last_check = 0;
+SearchWorker	 workers[SEARCH_MAX_THREADS];
+SearchContext	 search_ctx = {.workers = workers, .report = true};
+HelperPool		 pool;
+_Atomic uint32_t abdada_table[ABDADA_TABLE_SIZE];  // moves currently searched by some thread
 
 SearchThreadArgs *ctl = NULL;
 
-void iter_deepening(struct board *board, struct search_options *opts) {
-	SearchInfo info		   = {0};
-	nodes_since_last_check = 0;
-	info.time_start		   = time_now();
-	opts->time_limit = search_calculate_time_budget(opts, board->side);	 // relative time ie 400ms
-	// if depth isnt set, iterate until MAX_DEPTH-1 at most to avoid overflows
-	size_t max_depth = opts->depth != 0 ? opts->depth : MAX_DEPTH - 1;
+void iter_deepening(SearchWorker *w) {
+	SearchContext *ctx	   = w->ctx;
+	SearchOptions *opts	   = &ctx->opts;
+	SearchInfo	  *info	   = &w->info;
+	bool		   is_main = w->id == 0;
+	// iterate until MAX_DEPTH-1 at most to avoid overflows
+	size_t max_depth = opts->depth != 0 ? MIN(opts->depth, MAX_DEPTH - 1) : MAX_DEPTH - 1;
+
+	// the accumulators follow the board through make_move while this worker searches it
+	if (nnue_active()) {
+		if (!w->nnue)
+			w->nnue = nnue_state_create();
+		if (w->nnue)
+			nnue_attach(w->board, w->nnue);
+	}
 
+	int prev_score = 0;
 	for (size_t depth = 1; depth <= max_depth; depth++) {
 		int alpha = -INF;
 		int beta  = INF;
-		int score = 0;
-		memset(&pv_length, 0, sizeof(pv_length));
-
-		// aspiration window
-		if (depth > 1) {
-			alpha = score - ASPIRATION_WINDOW;
-			beta  = score + ASPIRATION_WINDOW;
+		int delta = ASPIRATION_WINDOW;
+		int score;
+		memset(&w->pv_length, 0, sizeof(w->pv_length));
+		info->seldepth = 0;
+
+		// with a shared TT only, half of the helpers search one ply ahead of the main thread so
+		// the threads dont all walk the same tree, ABDADA spreads the work by deferring moves.
+		// Nobody goes past the depth asked for
+		size_t search_depth = depth;
+		if (!is_main && opts->parallel_mode == PARALLEL_SHARED_TT)
+			search_depth = MIN(depth + (w->id & 1), max_depth);
+
+		// aspiration window centered on the previous iteration, mate scores get a full window
+		if (depth > 1 && abs(prev_score) < MATE_BOUND) {
+			alpha = prev_score - delta;
+			beta  = prev_score + delta;
 		}
 
-		score		  = search(depth, alpha, beta, 0, board, opts, &info, true);
-		info.score_cp = score;
-
-		// if the score exceeds the aspiration window, research with a full window
-		if (score <= alpha) {
-			alpha = -INF;
-			score = search(depth, alpha, beta, 0, board, opts, &info, true);
-		} else if (score >= beta) {
-			beta  = INF;
-			score = search(depth, alpha, beta, 0, board, opts, &info, true);
+		while (true) {
+			score = search(w, search_depth, alpha, beta, 0, true);
+			if (should_stop(ctx))
+				break;
+
+			// widen the failing side of the window geometrically and research
+			if (score <= alpha) {
+				alpha = delta >= ASPIRATION_MAX ? -INF : MAX(score - delta, -INF);
+			} else if (score >= beta) {
+				beta = delta >= ASPIRATION_MAX ? INF : MIN(score + delta, INF);
+			} else {
+				break;
+			}
+			delta *= 2;
+			STATS_INC(w, aspiration_researches);
+			log_debug("aspiration research at depth %zu: score %d window [%d, %d]",
+					  search_depth,
+					  score,
+					  alpha,
+					  beta);
 		}
+		// an interrupted iteration has no reliable score or PV, keep the last complete one
+		if (should_stop(ctx))
+			break;
+		prev_score = score;
 
-		uint32_t elapsed_ms = time_now() - info.time_start;
-		if (elapsed_ms == 0)
-			elapsed_ms = 1;
-		info.nps = info.nodes * 1000 / elapsed_ms;
+		if (!is_main)
+			continue;
 
-		if (pv_length[0] >= move_list_size(&root_pv)) {
-			move_list_clear(&root_pv);
-			for (size_t i = 0; i < pv_length[0]; ++i) {
-				move_list_push_back(&root_pv, pv_table[0][i]);
-			}
-		} else {
-			for (size_t i = 0; i < pv_length[0]; ++i) {
-				Move *m = move_list_at(&root_pv, i);
-				*m		= pv_table[0][i];
-			}
+		// the report counts flushed nodes only, the main thread's are all in
+		flush_nodes(w);
+		info->depth	   = depth;
+		info->score_cp = score;
+#ifdef SEARCH_STATS
+		info->stats.iterations			   = depth;
+		info->stats.iteration_nodes[depth] = search_nodes(ctx);
+#endif
+
+		// a shorter PV replaces the previous one completely, its tail belongs to another line
+		move_list_clear(&ctx->root_pv);
+		for (size_t i = 0; i < w->pv_length[0]; ++i) {
+			move_list_push_back(&ctx->root_pv, w->pv_table[0][i]);
 		}
 
-		send_msg_info(&info);
-		gstop_cond_eval(opts, &info);
-		if (search_should_stop())
+		if (ctx->report)
+			send_msg_info(ctx, info);
+		gstop_cond_eval(w);
+		if (should_stop(ctx))
 			break;
 	}
-	search_stop();
+	nnue_detach(w->board);
+	if (is_main)
+		stop(ctx);
 }
 
-int quiescence(Board *board, int alpha, int beta, int ply, SearchOptions *opts, SearchInfo *info) {
-	info->seldepth = ply;
-	info->nodes++;
+int quiescence(SearchWorker *w, int alpha, int beta, int ply) {
+	Board	   *board = w->board;
+	SearchInfo *info  = &w->info;
+	info->seldepth	  = MAX(info->seldepth, (uint32_t) ply);
+	count_node(w);
+	STATS_INC(w, qnodes);
 
-	gstop_cond_eval(opts, info);
-	if (search_should_stop() || is_repetition(board) || board->halfmove_clock > 99)
+	if (should_stop(w->ctx) || is_repetition(board) || board->halfmove_clock > 99)
 		return 0;
 
-	int best_score = eval(board);
-	if (best_score >= beta)
+	// any entry is at least as deep as a quiescence search
+	TEntry entry = {.eval = TT_NO_EVAL};
+	STATS_INC(w, tt_probes);
+	if (ttable_probe(board->hash, &entry, ply)) {
+		STATS_INC(w, tt_hits);
+		if (entry.bound == BOUND_EXACT || (entry.bound == BOUND_LOWER && entry.score >= beta) ||
+			(entry.bound == BOUND_UPPER && entry.score <= alpha)) {
+			STATS_INC(w, tt_cutoffs);
+			return entry.score;
+		}
+	}
+
+	// the static eval is kept with the TT entry, the eval cache still has positions whose entry
+	// was replaced
+	int stand_pat = entry.eval != TT_NO_EVAL ? entry.eval : evalcache_eval(board);
+	if (stand_pat >= beta) {
+		ttable_store(board->hash, 0, stand_pat, stand_pat, NO_MOVE, BOUND_LOWER, ply);
 		return beta;
+	}
+	if (ply >= MAX_PLY - 1)
+		return stand_pat;
+
+	int	 alpha_orig = alpha;
+	int	 best_score = stand_pat;
+	Move best_move	= NO_MOVE;
 	if (best_score > alpha)
 		alpha = best_score;
 
-	// might be good to generate promotions as well, anything that changes the mat balance
-	MoveList *moves = movegen_generate_captures(board, board->side);
-	if (move_list_size(moves))
-		move_list_sort(moves, mvv_lva_compare);
+	MoveList *moves = &w->qs_moves[ply];
+	movegen_generate_noisy(board, board->side, moves);
+	score_noisy_moves(moves, &entry);
 	for (size_t i = 0; i < move_list_size(moves); i++) {
-		Move move = *move_list_at(moves, i);
+		Move move = pick_move(moves, i);
+
+		// underpromotions are left to the main search
+		bool queen_prom = move.mv_type == MV_Q_PROM || move.mv_type == MV_Q_PROM_CAPTURE;
+		if (move.mv_type >= MV_N_PROM_CAPTURE && !queen_prom)
+			continue;
+
+		// delta pruning: skip captures that cant raise alpha even with a positional bonus
+		int gain = move.captured_type != EMPTY ? material_values[move.captured_type] : 0;
+		if (queen_prom)
+			gain += material_values[QUEEN] - material_values[PAWN];
+		if (stand_pat + gain + DELTA_MARGIN <= alpha)
+			continue;
 
 		if (!make_move(board, move))
 			continue;
-		int score = -quiescence(board, -beta, -alpha, ply + 1, opts, info);
+		ttable_prefetch(board->hash);
+		int score = -quiescence(w, -beta, -alpha, ply + 1);
 		unmake_move(board);
 
-		best_score = MAX(best_score, score);
+		if (should_stop(w->ctx))
+			return 0;
+
+		if (score > best_score) {
+			best_score = score;
+			best_move  = move;
+		}
 
 		if (score >= beta) {
-			move_list_destroy(&moves);
+			ttable_store(board->hash, 0, score, stand_pat, move, BOUND_LOWER, ply);
 			return score;
 		}
 		if (score > alpha)
 			alpha = score;
 	}
-	move_list_destroy(&moves);
+
+	ttable_store(board->hash,
+				 0,
+				 best_score,
+				 stand_pat,
+				 best_move,
+				 best_score > alpha_orig ? BOUND_EXACT : BOUND_UPPER,
+				 ply);
 	return best_score;
 }
 
 // PVS
-int search(int			  depth,
-		   int			  alpha,
-		   int			  beta,
-		   int			  ply,
-		   Board		 *board,
-		   SearchOptions *opts,
-		   SearchInfo	 *info,
-		   bool			  is_pv) {
-	pv_length[ply] = 0;
-	info->depth	   = ply;
-	info->seldepth = ply;
+int search(SearchWorker *w, int depth, int alpha, int beta, int ply, bool is_pv) {
+	Board	   *board = w->board;
+	SearchInfo *info  = &w->info;
+	w->pv_length[ply] = 0;
+	info->seldepth	  = MAX(info->seldepth, (uint32_t) ply);
 
 	if (depth == 0) {
-		return quiescence(board, alpha, beta, ply, opts, info);
+		return quiescence(w, alpha, beta, ply);
 	}
 
-	info->nodes++;
-	gstop_cond_eval(opts, info);
-
-	if (search_should_stop() || board->halfmove_clock > 99 || is_repetition(board))
+	count_node(w);
+	if (should_stop(w->ctx) || board->halfmove_clock > 99 || is_repetition(board))
 		return 0;
 
-	TEntry entry = {0};
-	if (ttable_probe(board->hash, &entry) && entry.depth >= depth) {
+	// mate distance pruning: even mating right here cant beat a shorter mate found earlier
+	if (ply > 0) {
+		alpha = MAX(alpha, -CHECKMATE + ply);
+		beta  = MIN(beta, CHECKMATE - ply - 1);
+		if (alpha >= beta)
+			return alpha;
+	}
+
+	TEntry entry = {.eval = TT_NO_EVAL};
+	STATS_INC(w, tt_probes);
+	bool tt_hit = ttable_probe(board->hash, &entry, ply);
+	if (tt_hit)
+		STATS_INC(w, tt_hits);
+	// never cut at the root, entries kept from previous searches would leave us without a PV
+	if (tt_hit && ply > 0 && entry.depth >= depth) {
 		if (!is_pv) {
 			if (entry.bound == BOUND_EXACT) {
+				STATS_INC(w, tt_cutoffs);
 				return entry.score;
 			} else if (entry.bound == BOUND_LOWER && entry.score >= beta) {
+				STATS_INC(w, tt_cutoffs);
 				return beta;
 			} else if (entry.bound == BOUND_UPPER && entry.score <= alpha) {
+				STATS_INC(w, tt_cutoffs);
 				return alpha;
 			}
 		} else {
 			if (entry.bound == BOUND_EXACT) {
-				pv_table[ply][0] = entry.best_move;
-				pv_length[ply]	 = 1;
+				STATS_INC(w, tt_cutoffs);
+				// the packed move could come from a key collision, only trust it if it is legal
+				Move tt_move = tt_move_find(board, entry.move);
+				if (!move_equals(tt_move, NO_MOVE)) {
+					w->pv_table[ply][0] = tt_move;
+					w->pv_length[ply]	= 1;
+				}
 				return entry.score;
 			}
 		}
 	}
 
+	// the static eval is stored with the entry so that quiescence finds it when it reaches the
+	// position later, it is meaningless in check
+	bool in_check	 = board_is_check(board, board->side);
+	int	 static_eval = TT_NO_EVAL;
+	if (!in_check)
+		static_eval = entry.eval != TT_NO_EVAL ? entry.eval : evalcache_eval(board);
+
+	if (!is_pv && probcut(w, depth, beta, ply, static_eval, &entry.score))
+		return entry.score;
+
 	MoveList *moves = movegen_generate(board, board->side);
 
 	Move	  best_move	  = NO_MOVE;
 	int		  best_score  = -INF;
 	BoundType tt_bound	  = BOUND_UPPER;  // default to score<=alpha
 	int		  legal_moves = 0;
-	sort_moves(moves, &entry, ply, board->side);
-
-	for (size_t i = 0; i < move_list_size(moves); i++) {
-		gstop_cond_eval(opts, info);
-		if (search_should_stop()) {
+	sort_moves(w, moves, &entry, ply);
+
+	// ABDADA: once the first move has been searched, moves that another thread is already
+	// searching are deferred to a second pass so the threads split the remaining siblings
+	bool	abdada = w->ctx->opts.parallel_mode == PARALLEL_ABDADA && w->ctx->opts.threads > 1 &&
+				  depth >= ABDADA_MIN_DEPTH;
+	uint8_t deferred[MAX_MOVES];
+	size_t	deferred_cnt = 0;
+	size_t	moves_cnt	 = move_list_size(moves);
+
+	for (size_t n = 0; n < moves_cnt + deferred_cnt; n++) {
+		if (should_stop(w->ctx)) {
 			move_list_destroy(&moves);
 			return 0;
 		}
-		Move mv = *move_list_at(moves, i);
+		size_t	 i		  = n < moves_cnt ? n : deferred[n - moves_cnt];
+		Move	 mv		  = *move_list_at(moves, i);
+		uint64_t move_key = 0;
+		if (abdada && legal_moves > 0) {
+			move_key = abdada_move_key(board, mv);
+			if (n < moves_cnt && abdada_is_busy(move_key)) {
+				deferred[deferred_cnt++] = i;
+				continue;
+			}
+		}
 		if (!make_move(board, mv)) {
 			continue;
 		}
+		// the child probes this bucket first thing, start loading it while the move is set up
+		ttable_prefetch(board->hash);
 		legal_moves++;
 
 		int score;
-		if (i == 0) {
+		if (legal_moves == 1) {
 			// full width search on the first move
-			score = -search(depth - 1, -beta, -alpha, ply + 1, board, opts, info, is_pv);
+			score = -search(w, depth - 1, -beta, -alpha, ply + 1, is_pv);
 		} else {
+			if (move_key)
+				abdada_set_busy(move_key);
 			// reduced width search
-			score = -search(depth - 1, -alpha - 1, -alpha, ply + 1, board, opts, info, false);
+			STATS_INC(w, scouts);
+			score = -search(w, depth - 1, -alpha - 1, -alpha, ply + 1, false);
 			if (score > alpha && score < beta) {
 				// full width research
-				score = -search(depth - 1, -beta, -alpha, ply + 1, board, opts, info, is_pv);
+				STATS_INC(w, scout_researches);
+				score = -search(w, depth - 1, -beta, -alpha, ply + 1, is_pv);
 			}
+			if (move_key)
+				abdada_clear_busy(move_key);
 		}
 
 		unmake_move(board);
 		best_score = MAX(best_score, score);
 
 		if (score >= beta) {
+			STATS_INC(w, beta_cutoffs);
+			if (legal_moves == 1)
+				STATS_INC(w, first_move_cutoffs);
 			// killer heuristic
 			if (mv.captured_type == EMPTY) {
-				killer_moves[ply][1] = killer_moves[ply][0];
-				killer_moves[ply][0] = mv;
+				w->killer_moves[ply][1] = w->killer_moves[ply][0];
+				w->killer_moves[ply][0] = mv;
 			}
 			// history heuristic
-			history_heuristic[board->side][mv.from][mv.to] += depth * depth;
+			w->history_heuristic[board->side][mv.from][mv.to] += depth * depth;
 
 			// alpha	 = beta;
-			tt_bound = BOUND_LOWER;
+			best_move = mv;
+			tt_bound  = BOUND_LOWER;
 			break;
 		}
 
@@ -281,38 +481,207 @@ int search(int			  depth,
 			best_move = mv;
 			tt_bound  = BOUND_EXACT;
 
-			pv_table[ply][0] = mv;
-			pv_length[ply]	 = 1;
-			if ((ply + 1) < MAX_DEPTH && pv_length[ply + 1] > 0) {
+			w->pv_table[ply][0] = mv;
+			w->pv_length[ply]	= 1;
+			if ((ply + 1) < MAX_DEPTH && w->pv_length[ply + 1] > 0) {
 				// copy the child's PV
-				memcpy(&pv_table[ply][1],
-					   &pv_table[ply + 1][0],
-					   sizeof(pv_table[ply][0]) * pv_length[ply + 1]);
-				pv_length[ply] += pv_length[ply + 1];
+				memcpy(&w->pv_table[ply][1],
+					   &w->pv_table[ply + 1][0],
+					   sizeof(w->pv_table[ply][0]) * w->pv_length[ply + 1]);
+				w->pv_length[ply] += w->pv_length[ply + 1];
 			}
 		}
 	}
 	move_list_destroy(&moves);
 
-	int tt_score = best_score;
 	if (legal_moves == 0) {
-		if (board_is_check(board, board->side)) {
+		if (in_check) {
 			// shorter mate preferred
 			best_score = -CHECKMATE + ply;
-			tt_score   = -CHECKMATE;  // store normalized score
 		} else {
 			// stalemate
 			best_score = 0;
 		}
+		tt_bound = BOUND_EXACT;
 	}
 
-	if (!move_equals(best_move, NO_MOVE)) {
-		ttable_store(board->hash, depth, tt_score, best_move, tt_bound);
-	}
+	// fail lows and mated positions are stored as well, without a move. An interrupted child
+	// returned 0, which would be stored as a bound it never proved
+	if (!should_stop(w->ctx))
+		ttable_store(board->hash, depth, best_score, static_eval, best_move, tt_bound, ply);
 	assert(best_score != -INF && best_score != INF);
 	return best_score;
 }
 
+// ProbCut: if a good capture searched at reduced depth beats beta by a margin, the full depth
+// search would very likely fail high as well
+static bool probcut(SearchWorker *w,
+					int			  depth,
+					int			  beta,
+					int			  ply,
+					int			  static_eval,
+					int			 *out_score) {
+	Board		  *board	 = w->board;
+	SearchOptions *opts		 = &w->ctx->opts;
+	int			   reduction = opts->probcut_depth;
+	if (reduction == 0 || depth <= reduction || abs(beta) >= MATE_BOUND ||
+		board_is_check(board, board->side))
+		return false;
+
+	int		  pc_beta = beta + opts->probcut_margin;
+	bool	  cut	  = false;
+	MoveList *moves	  = movegen_generate_captures(board, board->side);
+	if (move_list_size(moves))
+		move_list_sort(moves, mvv_lva_compare);
+	for (size_t i = 0; i < move_list_size(moves) && !cut; i++) {
+		Move mv = *move_list_at(moves, i);
+		if (!see_ge(board, mv, 0) || !make_move(board, mv))
+			continue;
+		ttable_prefetch(board->hash);
+
+		// confirm with quiescence first, it is much cheaper than the reduced search
+		int score = -quiescence(w, -pc_beta, -pc_beta + 1, ply + 1);
+		if (score >= pc_beta)
+			score = -search(w, depth - reduction, -pc_beta, -pc_beta + 1, ply + 1, false);
+		unmake_move(board);
+
+		if (!should_stop(w->ctx) && score >= pc_beta) {
+			ttable_store(
+				board->hash, depth - reduction + 1, score, static_eval, mv, BOUND_LOWER, ply);
+			*out_score = score;
+			cut		   = true;
+		}
+	}
+	move_list_destroy(&moves);
+	return cut;
+}
+
+/*
+ * Parallel search
+ */
+
+static int helper_thread(void *arg) {
+	SearchWorker *w = arg;
+	log_trace("helper %d started", w->id);
+	mtx_lock(&pool.lock);
+	while (true) {
+		while (!pool.shutdown && w->pool_epoch == pool.epoch) {
+			cnd_wait(&pool.wake, &pool.lock);
+		}
+		if (pool.shutdown)
+			break;
+		w->pool_epoch = pool.epoch;
+		// with fewer Threads than in an earlier search the surplus helpers sit this one out
+		if ((uint32_t) w->id > pool.active)
+			continue;
+		mtx_unlock(&pool.lock);
+
+		log_trace("helper %d searching", w->id);
+		iter_deepening(w);
+		log_trace("helper %d done", w->id);
+
+		mtx_lock(&pool.lock);
+		if (--pool.running == 0)
+			cnd_signal(&pool.done);
+	}
+	mtx_unlock(&pool.lock);
+	log_trace("helper %d stopped", w->id);
+	return 0;
+}
+
+// helpers search their own copy of the root position and only communicate through the TT
+static void helpers_start(void) {
+	Board *root = search_ctx.board;
+	for (uint32_t i = 1; i < search_ctx.opts.threads; i++) {
+		SearchWorker *w = &workers[i];
+		if (!w->board) {
+			w->board = board_create();
+			assert(w->board != NULL);
+		}
+		HistoryList *history = w->board->history;
+		*w->board			 = *root;
+		w->board->history	 = history;
+		history_clone(w->board->history, root->history);
+
+		age_search_state(w);
+		memset(&w->info, 0, sizeof(w->info));
+		w->info.time_start = workers[0].info.time_start;
+		w->nodes_unflushed = 0;
+	}
+
+	mtx_lock(&pool.lock);
+	while (pool.started + 1 < search_ctx.opts.threads) {
+		SearchWorker *w = &workers[pool.started + 1];
+		w->pool_epoch	= pool.epoch;
+		if (thrd_create(&w->thread, helper_thread, w) != thrd_success) {
+			log_error("failed to start search helper %u", pool.started + 1);
+			search_ctx.opts.threads = pool.started + 1;
+			break;
+		}
+		pool.started++;
+	}
+	pool.active	 = search_ctx.opts.threads - 1;
+	pool.running = pool.active;
+	pool.epoch++;
+	cnd_broadcast(&pool.wake);
+	mtx_unlock(&pool.lock);
+}
+
+static void helpers_join(void) {
+	mtx_lock(&pool.lock);
+	while (pool.running > 0) {
+		cnd_wait(&pool.done, &pool.lock);
+	}
+	mtx_unlock(&pool.lock);
+}
+
+// wakes the idle helpers for good, called once the search thread stops
+static void helpers_shutdown(void) {
+	mtx_lock(&pool.lock);
+	pool.shutdown = true;
+	cnd_broadcast(&pool.wake);
+	mtx_unlock(&pool.lock);
+	for (uint32_t i = 1; i <= pool.started; i++) {
+		thrd_join(workers[i].thread, NULL);
+	}
+	pool.started = 0;
+}
+
+// the threads publish their nodes through flush_nodes only, a running helper can be up to a
+// batch ahead of the count
+static uint64_t search_nodes(const SearchContext *ctx) {
+	return atomic_load_explicit(&ctx->nodes, memory_order_relaxed);
+}
+
+static uint64_t abdada_move_key(const Board *board, Move move) {
+	uint64_t mv = (uint64_t) move.from | (uint64_t) move.to << 6 | (uint64_t) move.mv_type << 12;
+	// multiply to spread the few move bits across the whole key
+	return board->hash ^ ((mv + 1) * 0x9E3779B97F4A7C15ULL);
+}
+
+static bool abdada_is_busy(uint64_t move_key) {
+	uint32_t tag = move_key >> 32;
+	uint32_t cur = atomic_load_explicit(&abdada_table[move_key & (ABDADA_TABLE_SIZE - 1)],
+										memory_order_relaxed);
+	return cur == tag;
+}
+
+static void abdada_set_busy(uint64_t move_key) {
+	atomic_store_explicit(&abdada_table[move_key & (ABDADA_TABLE_SIZE - 1)],
+						  (uint32_t) (move_key >> 32),
+						  memory_order_relaxed);
+}
+
+static void abdada_clear_busy(uint64_t move_key) {
+	// only clear the slot if another move hasnt claimed it in the meantime
+	uint32_t tag = move_key >> 32;
+	atomic_compare_exchange_strong_explicit(&abdada_table[move_key & (ABDADA_TABLE_SIZE - 1)],
+											&tag,
+											0,
+											memory_order_relaxed,
+											memory_order_relaxed);
+}
+
 /*
  * Lifetime
  */
@@ -326,14 +695,18 @@ int search_thread(void *arg) {
 
 	ctl->shutdown = false;
 
-	memset(pv_table, 0, sizeof(pv_table));
-	memset(pv_length, 0, sizeof(pv_length));
-	memset(killer_moves, 0, sizeof(killer_moves));
-	memset(history_heuristic, 0, sizeof(history_heuristic));
-	move_list_init_reserve(&root_pv, 32);
+	memset(workers, 0, sizeof(workers));
+	for (int i = 0; i < SEARCH_MAX_THREADS; i++) {
+		workers[i].id  = i;
+		workers[i].ctx = &search_ctx;
+	}
+	move_list_init_reserve(&search_ctx.root_pv, 32);
 
 	mtx_init(&search_ctx.lock, mtx_plain);
 	cnd_init(&search_ctx.cond);
+	mtx_init(&pool.lock, mtx_plain);
+	cnd_init(&pool.wake);
+	cnd_init(&pool.done);
 
 	while (!ctl->shutdown) {
 		mtx_lock(&search_ctx.lock);
@@ -344,18 +717,122 @@ int search_thread(void *arg) {
 			break;
 		mtx_unlock(&search_ctx.lock);
 		log_trace("searching");
-		iter_deepening(search_ctx.board, &search_ctx.opts);
+
+		SearchWorker *main_worker = &workers[0];
+		main_worker->board		  = search_ctx.board;
+		memset(&main_worker->info, 0, sizeof(main_worker->info));
+		main_worker->info.time_start = time_now();
+		main_worker->nodes_unflushed = 0;
+		atomic_store(&search_ctx.nodes, 0);
+		search_ctx.reported_nodes = 0;
+		// relative time ie 400ms
+		search_ctx.opts.time_limit = search_calculate_time_budget(&search_ctx.opts,
+																  search_ctx.board->side);
+		ttable_new_search();
+		move_list_clear(&search_ctx.root_pv);
+		age_search_state(main_worker);
+
+		helpers_start();
+		iter_deepening(main_worker);
+		helpers_join();
+		for (uint32_t i = 0; i < search_ctx.opts.threads; i++) {
+			flush_nodes(&workers[i]);
+		}
+		// the limits can stop the search before the first iteration completes
+		if (move_list_size(&search_ctx.root_pv) == 0)
+			root_pv_fallback(&search_ctx);
+		// final report with the exact node count, unless the last iteration already sent it
+		if (move_list_size(&search_ctx.root_pv) > 0 &&
+			search_nodes(&search_ctx) != search_ctx.reported_nodes)
+			send_msg_info(&search_ctx, &main_worker->info);
+
+#ifdef SEARCH_STATS
+		send_msg_stats(&search_ctx);
+#endif
 		// search finished, notify the main thread
-		send_msg_stop(&root_pv);
+		send_msg_stop(&search_ctx.root_pv);
 		log_trace("search done");
 	}
+	helpers_shutdown();
+	for (int i = 0; i < SEARCH_MAX_THREADS; i++) {
+		if (i > 0)
+			board_destroy(&workers[i].board);
+		nnue_state_destroy(&workers[i].nnue);
+		for (int ply = 0; ply < MAX_PLY; ply++) {
+			move_list_free(&workers[i].qs_moves[ply]);
+		}
+	}
+	move_list_free(&search_ctx.root_pv);
 	log_trace("search thread stopped");
 	return 0;
 }
 
+SearchWorker *search_worker_create(void) {
+	SearchWorker *w = calloc(1, sizeof(SearchWorker));
+	if (!w) {
+		log_error("failed to allocate search worker");
+		return NULL;
+	}
+	return w;
+}
+
+void search_worker_destroy(SearchWorker **w) {
+	if (!w || !*w)
+		return;
+	for (int ply = 0; ply < MAX_PLY; ply++) {
+		move_list_free(&(*w)->qs_moves[ply]);
+	}
+	nnue_state_destroy(&(*w)->nnue);
+	free(*w);
+	*w = NULL;
+}
+
+// runs a whole single threaded search on the calling thread without reporting to the engine,
+// searches on different workers and boards can run concurrently and only share the TT
+void search_run(SearchWorker		 *w,
+				struct board		 *board,
+				struct search_options options,
+				SearchResult		 *result) {
+	assert(w != NULL && board != NULL && result != NULL);
+	SearchContext ctx = {.board = board, .opts = options, .workers = w};
+	ctx.opts.threads  = 1;
+	ctx.searching	  = true;
+	move_list_init_reserve(&ctx.root_pv, 32);
+
+	// positions are unrelated, nothing learned in the previous one applies
+	memset(w->pv_table, 0, sizeof(w->pv_table));
+	memset(w->pv_length, 0, sizeof(w->pv_length));
+	memset(w->killer_moves, 0, sizeof(w->killer_moves));
+	memset(w->history_heuristic, 0, sizeof(w->history_heuristic));
+	memset(&w->info, 0, sizeof(w->info));
+	w->id				= 0;
+	w->ctx				= &ctx;
+	w->board			= board;
+	w->nodes_unflushed	= 0;
+	w->info.time_start	= time_now();
+	ctx.opts.time_limit = search_calculate_time_budget(&ctx.opts, board->side);
+
+	iter_deepening(w);
+	flush_nodes(w);
+	if (move_list_size(&ctx.root_pv) == 0)
+		root_pv_fallback(&ctx);
+
+	result->bestmove = move_list_size(&ctx.root_pv) ? *move_list_at(&ctx.root_pv, 0) : NO_MOVE;
+	result->score	 = (int) w->info.score_cp;
+	result->depth	 = w->info.depth;
+	result->nodes	 = atomic_load(&ctx.nodes);
+	result->time_ms	 = time_now() - w->info.time_start;
+	w->ctx			 = NULL;
+	move_list_free(&ctx.root_pv);
+}
+
 void search_start(struct board *board, struct search_options options) {
 	assert(board != NULL);
 	log_trace("starting search");
+	if (options.threads < 1)
+		options.threads = 1;
+	if (options.threads > SEARCH_MAX_THREADS)
+		options.threads = SEARCH_MAX_THREADS;
 	mtx_lock(&search_ctx.lock);
 	search_ctx.board	 = board;
 	search_ctx.opts		 = options;
@@ -376,21 +853,77 @@ void search_shutdown(void) {
 }
 
 void search_reset(void) {
-	memset(pv_table, 0, sizeof(pv_table));
-	memset(pv_length, 0, sizeof(pv_length));
-	memset(killer_moves, 0, sizeof(killer_moves));
-	memset(history_heuristic, 0, sizeof(history_heuristic));
-	move_list_clear(&root_pv);
+	for (int i = 0; i < SEARCH_MAX_THREADS; i++) {
+		SearchWorker *w = &workers[i];
+		memset(w->pv_table, 0, sizeof(w->pv_table));
+		memset(w->pv_length, 0, sizeof(w->pv_length));
+		memset(w->killer_moves, 0, sizeof(w->killer_moves));
+		memset(w->history_heuristic, 0, sizeof(w->history_heuristic));
+	}
+	move_list_clear(&search_ctx.root_pv);
+}
+
+// keeps the move ordering data learned in the previous search instead of wiping it
+static void age_search_state(SearchWorker *w) {
+	// the root is now two plies deeper in the game than in the previous search
+	memmove(&w->killer_moves[0],
+			&w->killer_moves[2],
+			sizeof(w->killer_moves[0]) * (MAX_DEPTH - 2));
+	memset(&w->killer_moves[MAX_DEPTH - 2], 0, sizeof(w->killer_moves[0]) * 2);
+
+	for (Player p = PLAYER_W; p < PLAYER_CNT; p++) {
+		for (Square from = SQ_A1; from < SQ_CNT; from++) {
+			for (Square to = SQ_A1; to < SQ_CNT; to++) {
+				w->history_heuristic[p][from][to] /= HISTORY_DECAY;
+			}
+		}
+	}
+}
+
+// legal move of the position matching a packed TT move, NO_MOVE if there is none
+static Move tt_move_find(Board *board, uint16_t packed) {
+	Move	  found = NO_MOVE;
+	MoveList *moves = movegen_generate(board, board->side);
+	for (size_t i = 0; i < move_list_size(moves) && packed; i++) {
+		Move mv = *move_list_at(moves, i);
+		if (ttable_pack_move(mv) == packed && make_move(board, mv)) {
+			unmake_move(board);
+			found = mv;
+			break;
+		}
+	}
+	move_list_destroy(&moves);
+	return found;
+}
+
+// plays the first legal move when no iteration could complete
+static void root_pv_fallback(SearchContext *ctx) {
+	Board	 *board = ctx->board;
+	MoveList *moves = movegen_generate(board, board->side);
+	for (size_t i = 0; i < move_list_size(moves); i++) {
+		Move mv = *move_list_at(moves, i);
+		if (make_move(board, mv)) {
+			unmake_move(board);
+			move_list_push_back(&ctx->root_pv, mv);
+			break;
+		}
+	}
+	move_list_destroy(&moves);
 }
 
 void search_stop(void) {
 	log_trace("stopping search");
-	search_ctx.searching = false;
+	stop(&search_ctx);
 	log_trace("search stop signal sent");
 }
 
-bool search_should_stop(void) {
-	return !search_ctx.searching || ctl->shutdown;
+static void stop(SearchContext *ctx) {
+	ctx->searching = false;
+}
+
+static bool should_stop(const SearchContext *ctx) {
+	// ctl is only set when the UCI search thread is running
+	return !ctx->searching || (ctl && ctl->shutdown);
 }
 
 /*
@@ -439,34 +972,60 @@ uint32_t time_now(void) {
 	return timeval_to_ms(tv);
 }
 
-void gstop_cond_eval(SearchOptions *options, SearchInfo *info) {
+void gstop_cond_eval(SearchWorker *w) {
 	// NOTE: depth is evaluated by the function performing iterative deepening
+	// and the node limit by count_node
 
-	if (search_should_stop()) {
-		log_debug("search already stopped");
+	// helpers follow the decision of the main thread
+	if (w->id != 0)
 		return;
-	}
-	nodes_since_last_check++;
-	if (nodes_since_last_check < TIME_CHECK_INTERVAL) {
-		return;
-	}
 
-	if (options->nodes && info->nodes >= options->nodes) {
-		log_trace("node limit reached: set %u nodes %u", options->nodes, info->nodes);
-		search_stop();
+	if (should_stop(w->ctx)) {
+		log_debug("search already stopped");
 		return;
 	}
 
+	SearchOptions *options = &w->ctx->opts;
 	if (!options->infinite) {
 		uint32_t timenow = time_now();
-		if ((timenow - info->time_start) >= options->time_limit) {
-			log_trace("time limit reached: elapsed %u ms", timenow - options->time_limit);
-			search_stop();
+		if ((timenow - w->info.time_start) >= options->time_limit) {
+			log_trace("time limit reached: elapsed %u ms", timenow - w->info.time_start);
+			stop(w->ctx);
 			return;
 		}
 	}
 }
 
+// counts the nodes locally and adds them to the shared counter in batches, a thread stops once
+// its unflushed nodes would take the shared count to the limit so the overshoot is bounded by
+// the batches the other threads havent flushed yet
+static void count_node(SearchWorker *w) {
+	if (should_stop(w->ctx))
+		return;
+	w->info.nodes++;
+	w->nodes_unflushed++;
+
+	uint64_t limit = w->ctx->opts.nodes;
+	if (limit) {
+		uint64_t total = atomic_load_explicit(&w->ctx->nodes, memory_order_relaxed);
+		if (total + w->nodes_unflushed >= limit) {
+			flush_nodes(w);
+			log_trace("node limit of %lu nodes reached", limit);
+			stop(w->ctx);
+			return;
+		}
+	}
+	if (w->nodes_unflushed >= NODE_BATCH) {
+		flush_nodes(w);
+		gstop_cond_eval(w);
+	}
+}
+
+static void flush_nodes(SearchWorker *w) {
+	atomic_fetch_add_explicit(&w->ctx->nodes, w->nodes_unflushed, memory_order_relaxed);
+	w->nodes_unflushed = 0;
+}
+
 /*
  * Score functions
  */
@@ -477,13 +1036,39 @@ static int compare_move(const void *m1, const void *m2) {
 	return move2->score - move1->score;
 }
 
-static void sort_moves(MoveList *moves, TEntry *tte, int ply, Player side) {
+static void sort_moves(SearchWorker *w, MoveList *moves, TEntry *tte, int ply) {
 	for (size_t i = 0; i < move_list_size(moves); i++) {
-		score_move(move_list_at(moves, i), ply, side, tte);
+		score_move(w, move_list_at(moves, i), ply, tte);
 	}
 	move_list_sort(moves, compare_move);
 }
 
+static void score_noisy_moves(MoveList *moves, TEntry *tte) {
+	for (size_t i = 0; i < move_list_size(moves); i++) {
+		Move *move = move_list_at(moves, i);
+		if (tte->move && ttable_pack_move(*move) == tte->move)
+			move->score = SCORE_TT;
+		else if (move->captured_type != EMPTY)
+			move->score = mvv_lva[move->piece.type][move->captured_type] + SCORE_CAPTURE;
+		else
+			move->score = SCORE_KILLER_FIRST;  // quiet queen promotion
+	}
+}
+
+// moves the best scored remaining move to position i, cheaper than sorting the whole list when
+// a cutoff comes early
+static Move pick_move(MoveList *moves, size_t i) {
+	size_t best = i;
+	for (size_t j = i + 1; j < move_list_size(moves); j++) {
+		if (move_list_at(moves, j)->score > move_list_at(moves, best)->score)
+			best = j;
+	}
+	Move picked				   = *move_list_at(moves, best);
+	*move_list_at(moves, best) = *move_list_at(moves, i);
+	*move_list_at(moves, i)	   = picked;
+	return picked;
+}
+
 static int mvv_lva_compare(const void *x, const void *y) {
 	Move *xt	= (Move *) x;
 	Move *yt	= (Move *) y;
@@ -496,18 +1081,19 @@ static int mvv_lva_compare(const void *x, const void *y) {
 	return 0;
 }
 
-static void score_move(Move *move, int ply, Player side, TEntry *tte) {
-	// check if the TEntry is not empty before performing the comparison
-	if (tte->key && move_equals(*move, tte->best_move))
+static void score_move(SearchWorker *w, Move *move, int ply, TEntry *tte) {
+	Player side = w->board->side;
+	// check if the TEntry has a move before performing the comparison
+	if (tte->move && ttable_pack_move(*move) == tte->move)
 		move->score = SCORE_TT;
 	else if (move->captured_type != EMPTY)
 		move->score = mvv_lva[move->piece.type][move->captured_type] + SCORE_CAPTURE;
-	else if (move_equals(*move, killer_moves[ply][0]))
+	else if (move_equals(*move, w->killer_moves[ply][0]))
 		move->score = SCORE_KILLER_FIRST;
-	else if (move_equals(*move, killer_moves[ply][1]))
+	else if (move_equals(*move, w->killer_moves[ply][1]))
 		move->score = SCORE_KILLER_SECOND;
-	else if (history_heuristic[side][move->from][move->to] != 0)
-		move->score = history_heuristic[side][move->from][move->to] + SCORE_HISTORY;
+	else if (w->history_heuristic[side][move->from][move->to] != 0)
+		move->score = w->history_heuristic[side][move->from][move->to] + SCORE_HISTORY;
 	else
 		move->score = SCORE_NONE;
 }
@@ -536,18 +1122,27 @@ void free_msg(SearchMsg *msg) {
 		move_list_free(&msg->payload.search_info.pv);
 }
 
-static int send_msg_info(SearchInfo *info) {
+static int send_msg_info(SearchContext *ctx, SearchInfo *info) {
 	assert(info != NULL);
 	SearchMsg msg			= {0};
 	msg.type				= SEARCH_MSG_INFO;
 	msg.free_payload		= free_msg;
 	msg.payload.search_info = *info;
-	size_t pv_size			= move_list_size(&root_pv);
+	// report the work done by every thread, not only the main one
+	uint32_t elapsed_ms = time_now() - info->time_start;
+	if (elapsed_ms == 0)
+		elapsed_ms = 1;
+	msg.payload.search_info.nodes		 = search_nodes(ctx);
+	msg.payload.search_info.nps		 = msg.payload.search_info.nodes * 1000 / elapsed_ms;
+	msg.payload.search_info.hashfull = ttable_hashfull();
+	ctx->reported_nodes				 = msg.payload.search_info.nodes;
+
+	size_t pv_size = move_list_size(&ctx->root_pv);
 	if (pv_size > 0) {
 		log_debug("info payload init");
 		move_list_init(&msg.payload.search_info.pv);
 		log_debug("info payload cloning pv");
-		move_list_clone(&msg.payload.search_info.pv, &root_pv);
+		move_list_clone(&msg.payload.search_info.pv, &ctx->root_pv);
 	} else {
 		move_list_clear(&msg.payload.search_info.pv);
 	}
@@ -555,12 +1150,38 @@ static int send_msg_info(SearchInfo *info) {
 	return engmq_send_search_msg(&msg);
 }
 
+#ifdef SEARCH_STATS
+// totals of every thread, the iteration counters only come from the main thread
+static int send_msg_stats(SearchContext *ctx) {
+	SearchMsg msg	 = {0};
+	msg.type		 = SEARCH_MSG_STATS;
+	msg.free_payload = free_msg;
+
+	SearchStats *total = &msg.payload.search_stats;
+	*total			   = ctx->workers[0].info.stats;
+	for (uint32_t i = 1; i < ctx->opts.threads; i++) {
+		SearchStats *s = &ctx->workers[i].info.stats;
+		total->tt_probes += s->tt_probes;
+		total->tt_hits += s->tt_hits;
+		total->tt_cutoffs += s->tt_cutoffs;
+		total->qnodes += s->qnodes;
+		total->beta_cutoffs += s->beta_cutoffs;
+		total->first_move_cutoffs += s->first_move_cutoffs;
+		total->scouts += s->scouts;
+		total->scout_researches += s->scout_researches;
+		total->aspiration_researches += s->aspiration_researches;
+	}
+	total->nodes = search_nodes(ctx);
+	return engmq_send_search_msg(&msg);
+}
+#endif
+
 static int send_msg_stop(MoveList *pv) {
 	assert(pv != NULL);
 	SearchMsg msg	 = {0};
 	msg.type		 = SEARCH_MSG_STOP;
 	msg.free_payload = free_msg;
-	assert(move_list_size(&root_pv) > 0);
+	assert(move_list_size(pv) > 0);
 	msg.payload.bestmove = *move_list_at(pv, 0);
 	return engmq_send_search_msg(&msg);
 }
@@ -10,4 +10,12 @@ void search_reset(void);
 void search_start(struct board *board, struct search_options options);
 void search_stop(void);
 
+// independent searches that dont go through the engine thread, one worker per calling thread
+struct search_worker *search_worker_create(void);
+void				  search_worker_destroy(struct search_worker **w);
+void				  search_run(struct search_worker *w,
+								 struct board		  *board,
+								 struct search_options options,
+								 SearchResult		  *result);
+
 #endif	// SEARCH_H
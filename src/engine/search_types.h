@@ -1,29 +1,67 @@
 #ifndef SEARCH_TYPES_H
 #define SEARCH_TYPES_H
 
+#include <limits.h>
+
 #include "movelist.h"
 
+#define SEARCH_MAX_THREADS 64
+#define MAX_DEPTH		   64
+#define INF				   (INT_MAX - 100000)
+#define CHECKMATE		   (INF - 1000000)
+#define MATE_BOUND		   (CHECKMATE - MAX_DEPTH)	// scores beyond this are mate scores
+
+#define PROBCUT_MARGIN_DEFAULT 200
+#define PROBCUT_MARGIN_MAX	   1000
+#define PROBCUT_DEPTH_DEFAULT  4
+#define PROBCUT_DEPTH_MAX	   16
+
+typedef enum {
+	PARALLEL_SHARED_TT,	 // threads search independently and share results through the TT
+	PARALLEL_ABDADA,	 // threads defer moves already being searched by another thread
+} ParallelMode;
+
 typedef struct search_thread_args {
 	struct engine_config *config;
 	bool				  shutdown;
 } SearchThreadArgs;
 
 typedef struct search_options {
-	MoveList *searchmoves;
-	uint32_t  depth;
-	uint32_t  nodes;
-	uint32_t  movetime;
-	uint32_t  wtime;
-	uint32_t  btime;
-	uint32_t  winc;
-	uint32_t  binc;
-	uint32_t  movestogo;
-	uint32_t  mate;	 // mate in x moves
-	uint32_t  time_limit;
-	bool	  ponder;
-	bool	  infinite;
+	MoveList	*searchmoves;
+	uint32_t	 depth;
+	uint32_t	 nodes;
+	uint32_t	 movetime;
+	uint32_t	 wtime;
+	uint32_t	 btime;
+	uint32_t	 winc;
+	uint32_t	 binc;
+	uint32_t	 movestogo;
+	uint32_t	 mate;	 // mate in x moves
+	uint32_t	 time_limit;
+	uint32_t	 threads;
+	ParallelMode parallel_mode;
+	uint32_t	 probcut_margin;  // centipawns above beta a capture has to prove
+	uint32_t	 probcut_depth;	  // depth reduction of the ProbCut search, 0 disables it
+	bool		 ponder;
+	bool		 infinite;
 } SearchOptions;
 
+// counters collected when the engine is built with SEARCH_STATS, otherwise they stay at zero
+typedef struct search_stats {
+	uint64_t nodes;
+	uint64_t tt_probes;
+	uint64_t tt_hits;
+	uint64_t tt_cutoffs;
+	uint64_t qnodes;
+	uint64_t beta_cutoffs;
+	uint32_t iterations;
+	uint64_t first_move_cutoffs;		  // beta cutoffs produced by the first legal move
+	uint64_t scouts;					  // null window searches of the moves after the first one
+	uint64_t scout_researches;			  // scouts searched again with the full window
+	uint32_t aspiration_researches;		  // researches caused by aspiration window failures
+	uint64_t iteration_nodes[MAX_DEPTH];  // total nodes when each iteration finished
+} SearchStats;
+
 typedef struct search_info {
 	uint32_t depth;
 	uint32_t seldepth;
@@ -31,25 +69,37 @@ typedef struct search_info {
 	uint32_t score_cp;	// score in centipawns
 	uint64_t nodes;
 	uint32_t nps;
-	// uint32_t hashfull;
+	uint32_t hashfull;	// permille of the TT used by the current search
 	// uint32_t tbhits;
 	uint32_t time_start;
 
+	SearchStats stats;
+
 	MoveList pv;
 } SearchInfo;
 
+// outcome of a search started with search_run
+typedef struct search_result {
+	Move	 bestmove;
+	int		 score;
+	uint32_t depth;
+	uint64_t nodes;
+	uint32_t time_ms;
+} SearchResult;
+
 /*
  * Message types to communicate with the engine thread
  */
 
-typedef enum { SEARCH_MSG_NONE, SEARCH_MSG_INFO, SEARCH_MSG_STOP } SearchMsgType;
+typedef enum { SEARCH_MSG_NONE, SEARCH_MSG_INFO, SEARCH_MSG_STATS, SEARCH_MSG_STOP } SearchMsgType;
 
 typedef struct search_msg {
 	SearchMsgType type;
 
 	union {
-		struct search_info search_info;
-		Move			   bestmove;
+		struct search_info	search_info;
+		struct search_stats search_stats;
+		Move				bestmove;
 	} payload;
 
 	void (*free_payload)(struct search_msg *msg);
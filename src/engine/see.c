@@ -0,0 +1,103 @@
+#include "see.h"
+
+#include <stdint.h>
+
+#include "bitboards.h"
+#include "bits.h"
+#include "board.h"
+#include "eval.h"
+#include "types.h"
+#include "utils.h"
+
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+// the order in which pieces are used to recapture
+static const PieceType see_order[] = {PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING};
+
+static int promotion_gain(MoveType type) {
+	switch (type) {
+		case MV_Q_PROM:
+		case MV_Q_PROM_CAPTURE:
+			return material_values[QUEEN] - material_values[PAWN];
+		case MV_R_PROM:
+		case MV_R_PROM_CAPTURE:
+			return material_values[ROOK] - material_values[PAWN];
+		case MV_B_PROM:
+		case MV_B_PROM_CAPTURE:
+			return material_values[BISHOP] - material_values[PAWN];
+		case MV_N_PROM:
+		case MV_N_PROM_CAPTURE:
+			return material_values[KNIGHT] - material_values[PAWN];
+		default:
+			return 0;
+	}
+}
+
+static PieceType least_valuable_attacker(const Board *board,
+										 uint64_t	  attackers,
+										 Player		  player,
+										 Square		 *out_sqr) {
+	for (size_t i = 0; i < sizeof(see_order) / sizeof(see_order[0]); i++) {
+		uint64_t bb = attackers & board->pieces[player][see_order[i]];
+		if (bb) {
+			*out_sqr = bits_get_lsb(bb);
+			return see_order[i];
+		}
+	}
+	return EMPTY;
+}
+
+int see(const Board *board, Move move) {
+	int		 gain[32];
+	int		 d			 = 0;
+	Square	 to			 = move.to;
+	uint64_t occupancies = board->occupancies[PLAYER_W] | board->occupancies[PLAYER_B];
+	uint64_t diagonal	 = board->pieces[PLAYER_W][BISHOP] | board->pieces[PLAYER_B][BISHOP] |
+					   board->pieces[PLAYER_W][QUEEN] | board->pieces[PLAYER_B][QUEEN];
+	uint64_t straight = board->pieces[PLAYER_W][ROOK] | board->pieces[PLAYER_B][ROOK] |
+						board->pieces[PLAYER_W][QUEEN] | board->pieces[PLAYER_B][QUEEN];
+
+	gain[0] = move.captured_type != EMPTY ? material_values[move.captured_type] : 0;
+	gain[0] += promotion_gain(move.mv_type);
+
+	// the piece standing on the target square after the move
+	int on_square = promotion_gain(move.mv_type) + material_values[move.piece.type];
+
+	bits_clear(&occupancies, move.from);
+	if (move.mv_type == MV_EN_PASSANT)
+		bits_clear(&occupancies, utils_ep_capture_pos(to, move.piece.player));
+
+	uint64_t attackers = board_attackers_to(board, to, occupancies) & occupancies;
+	Player	 side	   = utils_get_opponent(move.piece.player);
+
+	while (d < 31) {
+		Square	  from;
+		PieceType attacker = least_valuable_attacker(board, attackers, side, &from);
+		if (attacker == EMPTY)
+			break;
+
+		d++;
+		gain[d] = on_square - gain[d - 1];
+		// neither side can improve by continuing the exchange
+		if (MAX(-gain[d - 1], gain[d]) < 0)
+			break;
+
+		on_square = material_values[attacker];
+		bits_clear(&occupancies, from);
+		// removing the attacker might uncover a slider behind it
+		attackers |= bitboards_get_bishop_attacks(to, occupancies) & diagonal;
+		attackers |= bitboards_get_rook_attacks(to, occupancies) & straight;
+		attackers &= occupancies;
+		side = utils_get_opponent(side);
+	}
+
+	while (d > 0) {
+		gain[d - 1] = -MAX(-gain[d - 1], gain[d]);
+		d--;
+	}
+	return gain[0];
+}
+
+bool see_ge(const Board *board, Move move, int threshold) {
+	return see(board, move) >= threshold;
+}
@@ -0,0 +1,10 @@
+#ifndef SEE_H
+#define SEE_H
+
+#include "../include/types.h"
+
+// static exchange evaluation, material balance after all the captures on the target square
+int	 see(const Board *board, Move move);
+bool see_ge(const Board *board, Move move, int threshold);
+
+#endif	// SEE_H
@@ -0,0 +1,257 @@
+// Throughput mode: analyses a stream of positions with independent single threaded searches
+// running on a pool of threads that share the transposition table.
+//
+// Input, one position per line, limits default to the depth given on the command line:
+//   <id> <fen> [depth N] [nodes N] [movetime N]
+// Output, in completion order:
+//   <id> bestmove <move> score <cp|mate> <score> depth <depth> nodes <nodes> time <ms>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+
+#include "bitboards.h"
+#include "board.h"
+#include "hash.h"
+#include "log.h"
+#include "search.h"
+#include "transposition.h"
+#include "utils.h"
+
+#define QUEUE_SIZE	  256
+#define LINE_SIZE	  512
+#define DEFAULT_HASH  256  // MB
+#define DEFAULT_DEPTH 8
+
+// bounded so a huge input doesnt end up buffered in memory
+typedef struct job_queue {
+	char   lines[QUEUE_SIZE][LINE_SIZE];
+	size_t head;
+	size_t count;
+	bool   closed;	// input exhausted
+	mtx_t  lock;
+	cnd_t  not_empty;
+	cnd_t  not_full;
+} JobQueue;
+
+static void queue_push(const char *line);
+static bool queue_pop(char *out);
+static void queue_close(void);
+static int	worker_thread(void *arg);
+static void run_job(struct search_worker *w, Board *board, char *line);
+static uint32_t time_ms(void);
+
+static JobQueue queue;
+static mtx_t	output_lock;
+static uint32_t default_depth = DEFAULT_DEPTH;
+static uint64_t total_nodes	  = 0;
+static size_t	total_jobs	  = 0;
+
+int main(int argc, char *argv[]) {
+	if (argc < 2) {
+		printf("Usage: %s threads [hash MB (default: %d)] [depth (default: %d)] < positions\n",
+			   argv[0],
+			   DEFAULT_HASH,
+			   DEFAULT_DEPTH);
+		exit(EXIT_FAILURE);
+	}
+	int threads_count = atoi(argv[1]);
+	int hash_mb		  = argc > 2 ? atoi(argv[2]) : DEFAULT_HASH;
+	if (argc > 3)
+		default_depth = strtoul(argv[3], NULL, 10);
+	if (threads_count < 1 || hash_mb < TT_MIN_MB || hash_mb > TT_MAX_MB || default_depth < 1 ||
+		default_depth >= MAX_DEPTH) {
+		printf("Invalid arguments\n");
+		exit(EXIT_FAILURE);
+	}
+
+	log_set_level(LOG_WARN);
+	bitboards_init();
+	hash_init();
+	ttable_init(hash_mb, threads_count);
+
+	mtx_init(&queue.lock, mtx_plain);
+	cnd_init(&queue.not_empty);
+	cnd_init(&queue.not_full);
+	mtx_init(&output_lock, mtx_plain);
+
+	thrd_t *threads = calloc(threads_count, sizeof(thrd_t));
+	if (!threads) {
+		log_error("failed to allocate threads");
+		exit(EXIT_FAILURE);
+	}
+	for (int i = 0; i < threads_count; i++) {
+		if (thrd_create(&threads[i], worker_thread, NULL) != thrd_success) {
+			log_error("failed to start worker %d", i);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	uint32_t start = time_ms();
+	char	 line[LINE_SIZE];
+	while (fgets(line, LINE_SIZE, stdin)) {
+		line[strcspn(line, "\r\n")] = 0;
+		if (line[0] == 0 || line[0] == '#')
+			continue;
+		queue_push(line);
+	}
+	queue_close();
+
+	for (int i = 0; i < threads_count; i++) {
+		thrd_join(threads[i], NULL);
+	}
+	free(threads);
+
+	uint32_t elapsed = time_ms() - start;
+	if (elapsed == 0)
+		elapsed = 1;
+	fprintf(stderr,
+			"positions %zu nodes %lu time %u nps %lu\n",
+			total_jobs,
+			total_nodes,
+			elapsed,
+			total_nodes * 1000 / elapsed);
+
+	ttable_destroy();
+	mtx_destroy(&output_lock);
+	mtx_destroy(&queue.lock);
+	cnd_destroy(&queue.not_empty);
+	cnd_destroy(&queue.not_full);
+	return EXIT_SUCCESS;
+}
+
+static int worker_thread(void *arg) {
+	(void) arg;
+	struct search_worker *w		= search_worker_create();
+	Board				 *board = board_create();
+	if (!w || !board) {
+		log_error("failed to allocate worker state");
+		exit(EXIT_FAILURE);
+	}
+
+	char line[LINE_SIZE];
+	while (queue_pop(line)) {
+		run_job(w, board, line);
+	}
+
+	board_destroy(&board);
+	search_worker_destroy(&w);
+	return 0;
+}
+
+static void run_job(struct search_worker *w, Board *board, char *line) {
+	char *save = NULL;
+	char *id   = strtok_r(line, " \t", &save);
+	if (!id)
+		return;
+
+	// everything that isnt a limit is part of the FEN
+	char		  fen[LINE_SIZE] = {0};
+	SearchOptions opts			 = {.threads		= 1,
+									.probcut_margin = PROBCUT_MARGIN_DEFAULT,
+									.probcut_depth	= PROBCUT_DEPTH_DEFAULT};
+	char		 *tok;
+	while ((tok = strtok_r(NULL, " \t", &save))) {
+		uint32_t *limit = NULL;
+		if (strcmp(tok, "depth") == 0)
+			limit = &opts.depth;
+		else if (strcmp(tok, "nodes") == 0)
+			limit = &opts.nodes;
+		else if (strcmp(tok, "movetime") == 0)
+			limit = &opts.movetime;
+
+		if (limit) {
+			char *value = strtok_r(NULL, " \t", &save);
+			if (value)
+				*limit = strtoul(value, NULL, 10);
+			continue;
+		}
+		if (fen[0])
+			strcat(fen, " ");
+		strcat(fen, tok);
+	}
+	if (!opts.depth && !opts.nodes && !opts.movetime)
+		opts.depth = default_depth;
+	if (opts.depth >= MAX_DEPTH)
+		opts.depth = MAX_DEPTH - 1;
+
+	if (!board_from_fen(board, fen)) {
+		mtx_lock(&output_lock);
+		printf("%s error invalid fen\n", id);
+		fflush(stdout);
+		mtx_unlock(&output_lock);
+		return;
+	}
+
+	SearchResult res = {0};
+	search_run(w, board, opts, &res);
+
+	mtx_lock(&output_lock);
+	if (move_equals(res.bestmove, NO_MOVE))
+		printf("%s bestmove 0000", id);
+	else
+		printf("%s bestmove %s%s",
+			   id,
+			   utils_square_to_str(res.bestmove.from),
+			   utils_square_to_str(res.bestmove.to));
+	if (abs(res.score) >= MATE_BOUND) {
+		int plies = CHECKMATE - abs(res.score);
+		printf(" score mate %d", res.score > 0 ? (plies + 1) / 2 : -(plies / 2));
+	} else {
+		printf(" score cp %d", res.score);
+	}
+	printf(" depth %u nodes %lu time %u\n", res.depth, res.nodes, res.time_ms);
+	fflush(stdout);
+	total_nodes += res.nodes;
+	total_jobs++;
+	mtx_unlock(&output_lock);
+}
+
+static uint32_t time_ms(void) {
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * Job queue
+ */
+
+static void queue_push(const char *line) {
+	mtx_lock(&queue.lock);
+	while (queue.count == QUEUE_SIZE) {
+		cnd_wait(&queue.not_full, &queue.lock);
+	}
+	size_t tail = (queue.head + queue.count) % QUEUE_SIZE;
+	snprintf(queue.lines[tail], LINE_SIZE, "%s", line);
+	queue.count++;
+	cnd_signal(&queue.not_empty);
+	mtx_unlock(&queue.lock);
+}
+
+// false once the input is exhausted and every job has been taken
+static bool queue_pop(char *out) {
+	mtx_lock(&queue.lock);
+	while (queue.count == 0 && !queue.closed) {
+		cnd_wait(&queue.not_empty, &queue.lock);
+	}
+	if (queue.count == 0) {
+		mtx_unlock(&queue.lock);
+		return false;
+	}
+	memcpy(out, queue.lines[queue.head], LINE_SIZE);
+	queue.head = (queue.head + 1) % QUEUE_SIZE;
+	queue.count--;
+	cnd_signal(&queue.not_full);
+	mtx_unlock(&queue.lock);
+	return true;
+}
+
+static void queue_close(void) {
+	mtx_lock(&queue.lock);
+	queue.closed = true;
+	cnd_broadcast(&queue.not_empty);
+	mtx_unlock(&queue.lock);
+}
@@ -1,49 +1,667 @@
 #include "transposition.h"
 
 #include <assert.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <threads.h>
+#include <unistd.h>
 
 #include "log.h"
+#include "search_types.h"
+
+#define CACHE_LINE		 64
+#define BUCKET_ENTRIES	 6
+#define GENERATION_MASK	 0x3F	// generations wrap around after 64 searches, or games if shared
+#define AGE_WEIGHT		 8		// depth an entry loses for every search it falls behind
+#define TT_MATE			 32000	// mate scores are squeezed into 16 bits as TT_MATE - distance
+#define TT_MATE_BOUND	 (TT_MATE - 1000)
+#define HUGE_PAGE		 (2 * 1024 * 1024)
+#define CLEAR_THREADS	 64		// upper bound of threads sharing the zeroing of the table
+#define CLEAR_MIN_SLICE	 16384	// buckets (1 MB) an extra clearing thread gets at least
+#define HASHFULL_SAMPLE	 1000	// entries looked at to estimate the occupancy, one per permille
+#define SNAPSHOT_MAGIC	 "CHESSTT"
+#define SHARED_MAGIC	 "CHESSHM"
+#define SHARED_WAIT_MS	 5000  // time given to another process to finish creating a segment
+#define SNAPSHOT_VERSION 4	   // bump whenever the layout of TSlot or TBucket changes
+#define TABLE_HEADER	 4096  // buckets after a header start on their own page
+#define SLOT_CLAIMED	 1	   // slot being written by a store, reads as an empty entry
+
+// packed entry, the full TEntry is only rebuilt for the caller on a hit. Entries are kept in
+// the table as single 64 bit words read and written atomically, so threads never see a mix of
+// two entries and the table needs no lock
+typedef struct {
+	uint16_t key;  // upper 16 bits of the zobrist key, the index already selects the bucket
+	uint16_t move;
+	int16_t	 score;
+	uint8_t	 depth;
+	uint8_t	 genbound;	// generation << 2 | (bound + 1), 0 marks an empty entry
+} TSlot;
+
+// a probe only touches the cache line of its bucket. The slot words have no room left for the
+// static eval, the evals of the slots follow them in the rest of the line
+typedef struct {
+	_Alignas(CACHE_LINE) _Atomic uint64_t slots[BUCKET_ENTRIES];
+	_Atomic int16_t						  evals[BUCKET_ENTRIES];
+} TBucket;
+
+_Static_assert(sizeof(TBucket) == CACHE_LINE, "buckets must fill exactly one cache line");
 
 struct TTable {
-	TEntry*	 data;
-	uint32_t size;
-	uint32_t capacity;
+	TBucket*			  data;
+	uint32_t			  capacity;	 // buckets, always a power of two
+	uint32_t			  mask;		 // capacity - 1, selects the bucket from the low key bits
+	void*				  mapping;	 // start of the mmap region, headers come before data
+	size_t				  mapped;	 // bytes mapped, 0 if the table came from aligned_alloc
+	struct shared_header* shared;	 // set while attached to a shared memory segment
+	char				  shared_name[TT_SHARED_NAME_LIMIT];
+	uint8_t				  generation;	// private tables, shared ones keep it in the header
+	bool				  transparent;	// madvised for transparent huge pages
+	bool				  stale_evals;	// the evaluation changed, stored evals are ignored
 };
 
+typedef struct {
+	TBucket* start;
+	size_t	 count;
+} ClearSlice;
+
+// entries are only meaningful with the zobrist keys they were stored under, so the seed is
+// recorded and checked along with the layout
+typedef struct {
+	char	 magic[8];
+	uint32_t version;
+	uint32_t bucket_size;
+	uint64_t seed;
+	uint64_t buckets;
+	uint8_t	 generation;
+} SnapshotHeader;
+
+_Static_assert(sizeof(SnapshotHeader) <= TABLE_HEADER, "snapshot header doesnt fit its page");
+
+// header of a table shared between processes. Entries need no further coordination as every
+// bucket word is already read and written atomically and verified against its key
+typedef struct shared_header {
+	char		 magic[8];
+	uint32_t	 version;
+	uint32_t	 bucket_size;
+	uint64_t	 seed;
+	uint64_t	 buckets;
+	atomic_uint	 users;		  // attached processes, the last one to detach removes it
+	atomic_bool	 ready;		  // set by the creator once the table is zeroed
+	atomic_uchar generation;  // advanced by a new game in any process, searches keep it
+} SharedHeader;
+
+_Static_assert(sizeof(SharedHeader) <= TABLE_HEADER, "shared header doesnt fit its page");
+
 TTable ttable;
 
-void ttable_init(uint32_t size_mb) {
-	size_t size = size_mb * 1024 * 1024;
-	log_info("Allocating %zu bytes for transposition table", size);
-	ttable.capacity = size / sizeof(*ttable.data);
-	ttable.data		= calloc(ttable.capacity, sizeof(*ttable.data));
+// mate scores are relative to the root, the TT needs them relative to the node and in 16 bits
+static int16_t score_to_tt(int score, int ply) {
+	if (score >= MATE_BOUND)
+		return TT_MATE - (CHECKMATE - (score + ply));
+	if (score <= -MATE_BOUND)
+		return -TT_MATE + (CHECKMATE + (score - ply));
+	if (score >= TT_MATE_BOUND)
+		return TT_MATE_BOUND - 1;
+	if (score <= -TT_MATE_BOUND)
+		return -TT_MATE_BOUND + 1;
+	return score;
+}
+
+static int score_from_tt(int16_t score, int ply) {
+	if (score >= TT_MATE_BOUND)
+		return CHECKMATE - (TT_MATE - score) - ply;
+	if (score <= -TT_MATE_BOUND)
+		return -CHECKMATE + (TT_MATE + score) + ply;
+	return score;
+}
+
+uint16_t ttable_pack_move(Move move) {
+	if (move.from == SQ_NONE)
+		return 0;
+	return (uint16_t) (move.from | move.to << 6 | move.mv_type << 12);
+}
+
+// key 16 | generation and bound 8 | depth 8 | score 16 | move 16
+static uint64_t slot_pack(TSlot s) {
+	return (uint64_t) s.key << 48 | (uint64_t) s.genbound << 40 | (uint64_t) s.depth << 32 |
+		   (uint64_t) (uint16_t) s.score << 16 | s.move;
+}
+
+static TSlot slot_unpack(uint64_t word) {
+	return (TSlot) {.key	  = word >> 48,
+					.genbound = word >> 40,
+					.depth	  = word >> 32,
+					.score	  = (int16_t) (uint16_t) (word >> 16),
+					.move	  = word};
+}
+
+static TSlot slot_load(_Atomic uint64_t* slot) {
+	return slot_unpack(atomic_load_explicit(slot, memory_order_relaxed));
+}
+
+// the eval of the slot read as word, unknown if a store replaced the slot meanwhile. Stores
+// claim the slot before they write the eval, see slot_store
+static int16_t eval_load(TBucket* b, int i, uint64_t word) {
+	int16_t eval = atomic_load_explicit(&b->evals[i], memory_order_relaxed);
+	atomic_thread_fence(memory_order_acquire);
+	return atomic_load_explicit(&b->slots[i], memory_order_relaxed) == word ? eval : TT_NO_EVAL;
+}
+
+// a slot and its eval cant be written in one go. The slot is claimed first and a concurrent
+// store that finds it changed or claimed gives up, so an eval always belongs to its slot
+static void slot_store(TBucket* b, int i, uint64_t expected, TSlot s, int16_t eval) {
+	if (expected == SLOT_CLAIMED ||
+		!atomic_compare_exchange_strong_explicit(
+			&b->slots[i], &expected, SLOT_CLAIMED, memory_order_relaxed, memory_order_relaxed))
+		return;
+	atomic_thread_fence(memory_order_release);
+	atomic_store_explicit(&b->evals[i], eval, memory_order_relaxed);
+	atomic_store_explicit(&b->slots[i], slot_pack(s), memory_order_release);
+}
+
+// the eval is only kept if it fits the 16 bits of its place in the bucket
+static int16_t eval_to_tt(int eval) {
+	return eval > INT16_MIN && eval <= INT16_MAX ? eval : TT_NO_EVAL;
+}
+
+static uint8_t current_generation(void) {
+	if (ttable.shared)
+		return atomic_load_explicit(&ttable.shared->generation, memory_order_relaxed) &
+			   GENERATION_MASK;
+	return ttable.generation;
+}
+
+static uint8_t slot_generation(const TSlot* s) {
+	return s->genbound >> 2;
+}
+
+// searches an entry has fallen behind the current one
+static int slot_age(const TSlot* s) {
+	return (current_generation() - slot_generation(s)) & GENERATION_MASK;
+}
+
+static TBucket* bucket_of(uint64_t key) {
+	return &ttable.data[key & ttable.mask];
+}
+
+// prefers explicitly reserved huge pages, then transparent huge pages and finally falls back to
+// regular pages. Huge pages cover the table with far fewer TLB entries, which matters as every
+// probe lands on a random cache line
+static void table_alloc(size_t size) {
+	ttable.transparent = false;
+
+	size_t mapped = (size + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+	int	   prot	  = PROT_READ | PROT_WRITE;
+	void*  data	  = mmap(NULL, mapped, prot, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (data != MAP_FAILED) {
+		log_info("Transposition table uses explicit %d KB pages", HUGE_PAGE / 1024);
+		ttable.data	   = data;
+		ttable.mapping = data;
+		ttable.mapped  = mapped;
+		return;
+	}
+	data = mmap(NULL, mapped, prot, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (data != MAP_FAILED) {
+		// the kernel only backs the pages once they are touched, ttable_init checks what it got
+		ttable.transparent = madvise(data, mapped, MADV_HUGEPAGE) == 0;
+		if (!ttable.transparent)
+			log_info("Transposition table uses regular pages, transparent huge pages unavailable");
+		ttable.data	   = data;
+		ttable.mapping = data;
+		ttable.mapped  = mapped;
+		return;
+	}
+	log_warning("mmap failed, transposition table uses regular pages");
+	ttable.data	   = aligned_alloc(CACHE_LINE, size);
+	ttable.mapping = NULL;
+	ttable.mapped  = 0;
+}
+
+// KB of the mapping backed by transparent huge pages according to /proc/self/smaps, -1 if it
+// cant be read
+static long transparent_kb(void) {
+	FILE* smaps = fopen("/proc/self/smaps", "r");
+	if (!smaps)
+		return -1;
+	unsigned long start = (unsigned long) ttable.mapping;
+	unsigned long end	= start + ttable.mapped;
+	bool		  found = false;
+	bool		  ours	= false;
+	long		  total = 0;
+	char		  line[512];
+	while (fgets(line, sizeof(line), smaps)) {
+		unsigned long from, to;
+		long		  kb;
+		// every mapping starts with its address range, its fields follow
+		if (sscanf(line, "%lx-%lx ", &from, &to) == 2) {
+			ours = from >= start && to <= end;
+			found |= ours;
+		} else if (ours && sscanf(line, "AnonHugePages: %ld kB", &kb) == 1) {
+			total += kb;
+		}
+	}
+	fclose(smaps);
+	return found ? total : -1;
+}
+
+static void log_transparent_pages(void) {
+	long huge = transparent_kb();
+	long size = ttable.mapped / 1024;
+	if (huge < 0)
+		log_info("Transposition table requested transparent %d KB pages, the page size in use is "
+				 "unknown",
+				 HUGE_PAGE / 1024);
+	else if (huge == 0)
+		log_info("Transposition table uses regular pages, no transparent huge pages were given");
+	else
+		log_info("Transposition table uses transparent %d KB pages for %ld of %ld KB",
+				 HUGE_PAGE / 1024,
+				 huge,
+				 size);
+}
+
+static int clear_slice(void* arg) {
+	ClearSlice* slice = arg;
+	memset(slice->start, 0, slice->count * sizeof(TBucket));
+	return 0;
+}
+
+// each thread zeroes its own part of the table. Pages are placed on the NUMA node of the thread
+// that touches them first, so the table ends up spread across the nodes the scheduler runs these
+// threads on. They arent the search threads, which arent pinned either, so the layout only
+// follows the search as far as the scheduler spreads both alike
+static void table_clear(unsigned int threads) {
+	if (threads < 1)
+		threads = 1;
+	if (threads > CLEAR_THREADS)
+		threads = CLEAR_THREADS;
+	if (threads > ttable.capacity / CLEAR_MIN_SLICE)
+		threads = ttable.capacity / CLEAR_MIN_SLICE > 0 ? ttable.capacity / CLEAR_MIN_SLICE : 1;
+	thrd_t	   handles[CLEAR_THREADS];
+	ClearSlice slices[CLEAR_THREADS];
+	bool	   started[CLEAR_THREADS] = {0};
+	size_t	   per_thread			  = (ttable.capacity + threads - 1) / threads;
+	for (unsigned int i = 0; i < threads; i++) {
+		// the trailing slices are empty when there are almost as many threads as buckets
+		size_t first = i * per_thread < ttable.capacity ? i * per_thread : ttable.capacity;
+		size_t count = per_thread < ttable.capacity - first ? per_thread : ttable.capacity - first;
+		slices[i]	 = (ClearSlice) {.start = ttable.data + first, .count = count};
+		// the calling thread takes the first slice and any slice a thread couldnt be started for
+		if (i > 0)
+			started[i] = thrd_create(&handles[i], clear_slice, &slices[i]) == thrd_success;
+	}
+	for (unsigned int i = 0; i < threads; i++) {
+		if (!started[i])
+			clear_slice(&slices[i]);
+	}
+	for (unsigned int i = 1; i < threads; i++) {
+		if (started[i])
+			thrd_join(handles[i], NULL);
+	}
+}
+
+void ttable_init(uint32_t size_mb, unsigned int threads) {
+	assert(size_mb >= TT_MIN_MB && size_mb <= TT_MAX_MB);
+	size_t size = (size_t) size_mb * 1024 * 1024;
+	// round down to a power of two so the bucket is picked with a mask instead of a division
+	size_t buckets = 1;
+	while (buckets * 2 <= size / sizeof(TBucket))
+		buckets *= 2;
+	ttable.capacity = buckets;
+	ttable.mask		= buckets - 1;
+	log_info("Allocating %zu bytes for transposition table", buckets * sizeof(TBucket));
+	table_alloc(buckets * sizeof(TBucket));
 	assert(ttable.data != NULL);
+	table_clear(threads);
+	if (ttable.transparent)
+		log_transparent_pages();
+	ttable.generation = 0;
+}
+
+void ttable_reset(unsigned int threads) {
+	// a shared table is never cleared, another process can attach and start searching at any
+	// time. Moving to a new generation only makes the old entries the first to be replaced
+	if (ttable.shared) {
+		atomic_fetch_add_explicit(&ttable.shared->generation, 1, memory_order_relaxed);
+		return;
+	}
+	table_clear(threads);
+	ttable.generation = 0;
+}
+
+void ttable_eval_changed(unsigned int threads) {
+	ttable_reset(threads);
+	// the reset only ages the entries of a shared table, their evals stay until this process
+	// detaches
+	if (ttable.shared)
+		ttable.stale_evals = true;
 }
 
-void ttable_reset(void) {
-	ttable.size = 0;
+void ttable_new_search(void) {
+	// the searches of the processes sharing a table overlap, a search starting in one of them
+	// mustnt age the entries another one is still using
+	if (!ttable.shared)
+		ttable.generation = (ttable.generation + 1) & GENERATION_MASK;
 }
 
 void ttable_destroy(void) {
-	free(ttable.data);
+	if (ttable.shared) {
+		if (atomic_fetch_sub(&ttable.shared->users, 1) == 1) {
+			shm_unlink(ttable.shared_name);
+			log_info("Removed shared transposition table %s", ttable.shared_name);
+		}
+		ttable.shared = NULL;
+	}
+	if (ttable.mapped)
+		munmap(ttable.mapping, ttable.mapped);
+	else
+		free(ttable.data);
+	ttable.data		   = NULL;
+	ttable.mapping	   = NULL;
+	ttable.stale_evals = false;
+}
+
+static bool shared_header_valid(const SharedHeader* header, uint64_t seed, size_t segment) {
+	uint64_t buckets = header->buckets;
+	return memcmp(header->magic, SHARED_MAGIC, sizeof(SHARED_MAGIC)) == 0 &&
+		   header->version == SNAPSHOT_VERSION && header->bucket_size == sizeof(TBucket) &&
+		   header->seed == seed && buckets != 0 && (buckets & (buckets - 1)) == 0 &&
+		   segment == TABLE_HEADER + buckets * sizeof(TBucket);
 }
 
-bool ttable_probe(uint64_t key, TEntry* out_entry) {
-	TEntry e = ttable.data[key % ttable.capacity];
-	if (e.key == key) {
-		// log_info("Found %llu", key);
-		*out_entry = e;
+// creates the segment sized for size_mb, NULL if it exists already or cant be created
+static SharedHeader* shared_create(const char* name, uint32_t size_mb, uint64_t seed, size_t* out) {
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd < 0)
+		return NULL;
+	size_t buckets = 1;
+	while (buckets * 2 <= ((size_t) size_mb << 20) / sizeof(TBucket))
+		buckets *= 2;
+	size_t segment = TABLE_HEADER + buckets * sizeof(TBucket);
+	void*  mem	   = MAP_FAILED;
+	if (ftruncate(fd, segment) == 0)
+		mem = mmap(NULL, segment, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mem == MAP_FAILED) {
+		shm_unlink(name);
+		return NULL;
+	}
+	// ftruncate already zeroed the table
+	SharedHeader* header = mem;
+	memcpy(header->magic, SHARED_MAGIC, sizeof(SHARED_MAGIC));
+	header->version		= SNAPSHOT_VERSION;
+	header->bucket_size = sizeof(TBucket);
+	header->seed		= seed;
+	header->buckets		= buckets;
+	atomic_init(&header->users, 1);
+	atomic_store(&header->ready, true);
+	*out = segment;
+	log_info("Created shared transposition table %s with %zu bytes", name, segment);
+	return header;
+}
+
+// maps an existing segment, waiting for its creator to finish the setup
+static SharedHeader* shared_open(const char* name, uint64_t seed, size_t* out) {
+	int fd = shm_open(name, O_RDWR, 0600);
+	if (fd < 0)
+		return NULL;
+	struct stat st;
+	for (int waited = 0; fstat(fd, &st) == 0 && (size_t) st.st_size < TABLE_HEADER; waited++) {
+		if (waited == SHARED_WAIT_MS) {
+			close(fd);
+			return NULL;
+		}
+		thrd_sleep(&(struct timespec) {.tv_nsec = 1000000}, NULL);
+	}
+	size_t segment = st.st_size;
+	void*  mem	   = mmap(NULL, segment, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mem == MAP_FAILED)
+		return NULL;
+	SharedHeader* header = mem;
+	for (int waited = 0; !atomic_load(&header->ready); waited++) {
+		if (waited == SHARED_WAIT_MS) {
+			munmap(mem, segment);
+			return NULL;
+		}
+		thrd_sleep(&(struct timespec) {.tv_nsec = 1000000}, NULL);
+	}
+	if (!shared_header_valid(header, seed, segment)) {
+		log_error("shared transposition table %s doesnt match this engine", name);
+		munmap(mem, segment);
+		return NULL;
+	}
+	*out = segment;
+	return header;
+}
+
+bool ttable_attach_shared(const char* name, uint32_t size_mb, uint64_t seed, uint32_t* out_mb) {
+	if (strlen(name) >= TT_SHARED_NAME_LIMIT)
+		return false;
+	SharedHeader* header  = NULL;
+	size_t		  segment = 0;
+	// the segment can disappear between opening it and registering as a user when the last
+	// process detaches at the same time, in that case it is created again
+	for (int attempt = 0; attempt < 3 && !header; attempt++) {
+		header = shared_create(name, size_mb, seed, &segment);
+		if (header)
+			break;
+		header = shared_open(name, seed, &segment);
+		if (header && atomic_fetch_add(&header->users, 1) == 0) {
+			atomic_fetch_sub(&header->users, 1);
+			munmap(header, segment);
+			header = NULL;
+		}
+	}
+	if (!header) {
+		log_error("failed to attach to shared transposition table %s", name);
+		return false;
+	}
+
+	ttable_destroy();
+	ttable.shared	  = header;
+	ttable.mapping	  = header;
+	ttable.mapped	  = segment;
+	ttable.data		  = (TBucket*) ((char*) header + TABLE_HEADER);
+	ttable.capacity	  = header->buckets;
+	ttable.mask		  = header->buckets - 1;
+	ttable.generation = 0;	// unused while attached
+	strcpy(ttable.shared_name, name);
+	*out_mb = (header->buckets * sizeof(TBucket)) >> 20;
+	log_info("Attached to shared transposition table %s, %u users",
+			 name,
+			 atomic_load(&header->users));
+	return true;
+}
+
+bool ttable_save(const char* path, uint64_t seed) {
+	size_t table_size = (size_t) ttable.capacity * sizeof(TBucket);
+	size_t file_size  = TABLE_HEADER + table_size;
+	int	   fd		  = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		log_error("failed to create TT snapshot %s", path);
+		return false;
+	}
+	if (ftruncate(fd, file_size) != 0) {
+		log_error("failed to size TT snapshot %s", path);
+		close(fd);
+		return false;
+	}
+	void* file = mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (file == MAP_FAILED) {
+		log_error("failed to map TT snapshot %s", path);
+		return false;
+	}
+	SnapshotHeader header = {.magic		  = SNAPSHOT_MAGIC,
+							 .version	  = SNAPSHOT_VERSION,
+							 .bucket_size = sizeof(TBucket),
+							 .seed		  = seed,
+							 .buckets	  = ttable.capacity,
+							 .generation  = current_generation()};
+	memcpy(file, &header, sizeof(header));
+	memcpy((char*) file + TABLE_HEADER, ttable.data, table_size);
+	bool ok = msync(file, file_size, MS_SYNC) == 0;
+	munmap(file, file_size);
+	log_info("Saved %zu bytes of transposition table to %s", table_size, path);
+	return ok;
+}
+
+bool ttable_load(const char* path, uint64_t seed, uint32_t* size_mb) {
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		log_error("failed to open TT snapshot %s", path);
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t) st.st_size < TABLE_HEADER) {
+		log_error("%s is not a TT snapshot", path);
+		close(fd);
+		return false;
+	}
+	// a private mapping pages the entries in lazily on first probe and keeps the file untouched
+	// by the stores of later searches
+	size_t file_size = st.st_size;
+	void*  file		 = mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (file == MAP_FAILED) {
+		log_error("failed to map TT snapshot %s", path);
+		return false;
+	}
+
+	SnapshotHeader header;
+	memcpy(&header, file, sizeof(header));
+	uint64_t buckets = header.buckets;
+	uint64_t bytes	 = buckets * sizeof(TBucket);
+	if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+		header.version != SNAPSHOT_VERSION || header.bucket_size != sizeof(TBucket) ||
+		header.seed != seed || buckets == 0 || (buckets & (buckets - 1)) != 0 ||
+		bytes < (uint64_t) TT_MIN_MB << 20 || bytes > (uint64_t) TT_MAX_MB << 20 ||
+		file_size != TABLE_HEADER + bytes) {
+		log_error("TT snapshot %s doesnt match this engine", path);
+		munmap(file, file_size);
+		return false;
+	}
+
+	ttable_destroy();
+	ttable.data		  = (TBucket*) ((char*) file + TABLE_HEADER);
+	ttable.mapping	  = file;
+	ttable.mapped	  = file_size;
+	ttable.capacity	  = buckets;
+	ttable.mask		  = buckets - 1;
+	ttable.generation = header.generation & GENERATION_MASK;
+	*size_mb		  = bytes >> 20;
+	log_info("Loaded %lu bytes of transposition table from %s", bytes, path);
+	return true;
+}
+
+void ttable_resize(uint32_t size_mb, unsigned int threads) {
+	ttable_destroy();
+	ttable_init(size_mb, threads);
+}
+
+void ttable_prefetch(uint64_t key) {
+	__builtin_prefetch(bucket_of(key));
+}
+
+int ttable_hashfull(void) {
+	// the first buckets are as good a sample as any since keys are spread uniformly
+	int buckets = HASHFULL_SAMPLE / BUCKET_ENTRIES;
+	if ((uint32_t) buckets > ttable.capacity)
+		buckets = ttable.capacity;
+	int used = 0;
+	for (int i = 0; i < buckets; i++) {
+		for (int j = 0; j < BUCKET_ENTRIES; j++) {
+			TSlot s = slot_load(&ttable.data[i].slots[j]);
+			if (s.genbound && slot_age(&s) == 0)
+				used++;
+		}
+	}
+	return used * 1000 / (buckets * BUCKET_ENTRIES);
+}
+
+bool ttable_probe(uint64_t key, TEntry* out_entry, int ply) {
+	TBucket* b			= bucket_of(key);
+	uint16_t tag		= key >> 48;
+	uint8_t	 generation = current_generation();
+	for (int i = 0; i < BUCKET_ENTRIES; i++) {
+		uint64_t word = atomic_load_explicit(&b->slots[i], memory_order_acquire);
+		TSlot	 s	  = slot_unpack(word);
+		if (s.key != tag || !s.genbound)
+			continue;
+		int16_t eval = eval_load(b, i, word);
+		// refresh the entry so it survives into the current generation, losing the race against
+		// a concurrent store is fine
+		TSlot refreshed	   = s;
+		refreshed.genbound = generation << 2 | (s.genbound & 0x3);
+		if (refreshed.genbound != s.genbound)
+			atomic_compare_exchange_strong_explicit(&b->slots[i],
+													&word,
+													slot_pack(refreshed),
+													memory_order_relaxed,
+													memory_order_relaxed);
+		*out_entry = (TEntry) {.key		   = key,
+							   .depth	   = s.depth,
+							   .score	   = score_from_tt(s.score, ply),
+							   .eval	   = ttable.stale_evals ? TT_NO_EVAL : eval,
+							   .move	   = s.move,
+							   .bound	   = (s.genbound & 0x3) - 1,
+							   .generation = generation};
 		return true;
 	}
 	return false;
 }
 
-void ttable_store(uint64_t key, int depth, int score, Move best_move, BoundType bound) {
-	TEntry* e = &ttable.data[key % ttable.capacity];
-	if (e->depth < depth) {
-		*e = (TEntry) {
-			.key = key, .depth = depth, .score = score, .best_move = best_move, .bound = bound};
-		ttable.size++;
+void ttable_store(uint64_t	key,
+				  int		depth,
+				  int		score,
+				  int		eval,
+				  Move		best_move,
+				  BoundType	bound,
+				  int		ply) {
+	TBucket* b			 = bucket_of(key);
+	uint16_t tag		 = key >> 48;
+	int		 victim		 = 0;
+	uint64_t victim_word = atomic_load_explicit(&b->slots[0], memory_order_relaxed);
+	TSlot	 old		 = slot_unpack(victim_word);
+	for (int i = 0; i < BUCKET_ENTRIES; i++) {
+		uint64_t word = atomic_load_explicit(&b->slots[i], memory_order_relaxed);
+		TSlot	 s	  = slot_unpack(word);
+		if (!s.genbound || s.key == tag) {
+			victim		= i;
+			victim_word = word;
+			old			= s;
+			break;
+		}
+		// the least valuable entry is the shallowest once older generations are penalized
+		if (s.depth - AGE_WEIGHT * slot_age(&s) < old.depth - AGE_WEIGHT * slot_age(&old)) {
+			victim		= i;
+			victim_word = word;
+			old			= s;
+		}
 	}
+
+	bool same_position = old.genbound && old.key == tag;
+	// a shallower result for the same position only replaces entries from previous searches
+	if (same_position && slot_age(&old) == 0 && depth < old.depth)
+		return;
+
+	uint16_t move = ttable_pack_move(best_move);
+	// keep the known best move and static eval if this search didnt come up with them
+	if (!move && same_position)
+		move = old.move;
+	int16_t tt_eval = eval_to_tt(eval);
+	if (tt_eval == TT_NO_EVAL && same_position && !ttable.stale_evals)
+		tt_eval = eval_load(b, victim, victim_word);
+	TSlot entry = {.key		 = tag,
+				   .score	 = score_to_tt(score, ply),
+				   .move	 = move,
+				   .depth	 = depth,
+				   .genbound = current_generation() << 2 | (bound + 1)};
+	slot_store(b, victim, victim_word, entry, tt_eval);
 }
@@ -5,22 +5,66 @@
 
 #include "types.h"
 
+#define TT_DEFAULT_MB		 256
+#define TT_MIN_MB			 1
+#define TT_MAX_MB			 65536	// buckets are counted in 32 bits
+#define TT_SHARED_NAME_LIMIT 256
+#define TT_NO_EVAL			 INT16_MIN	// stored in place of a static eval that wasnt computed
+
 typedef enum { BOUND_LOWER, BOUND_EXACT, BOUND_UPPER } BoundType;
 
 typedef struct {
 	uint64_t  key;
 	int		  depth;
 	int		  score;
-	Move	  best_move;
+	int		  eval;	 // static eval of the position, TT_NO_EVAL if it isnt known
+	uint16_t  move;	 // best move packed by ttable_pack_move, 0 if there isnt one
 	BoundType bound;
+	uint8_t	  generation;  // search the entry was written or last hit in
 } TEntry;
 
 typedef struct TTable TTable;
 
-void ttable_init(uint32_t size_mb);
+// the table is zeroed by the given number of threads so its pages spread across NUMA nodes.
+// These are threads of their own rather than the search threads, callers pass the search thread
+// count so the pages at least spread across as many nodes
+void ttable_init(uint32_t size_mb, unsigned int threads);
 void ttable_destroy(void);
-void ttable_reset(void);
-bool ttable_probe(uint64_t key, TEntry *entry);
-void ttable_store(uint64_t key, int depth, int score, Move best_move, BoundType bound);
+// sizes that arent a power of two are rounded down, the previous contents are lost
+void ttable_resize(uint32_t size_mb, unsigned int threads);
+// snapshots are only valid for the zobrist seed they were saved with. Loading replaces the
+// table, resized to the snapshot, and reports the new size
+bool ttable_save(const char *path, uint64_t seed);
+bool ttable_load(const char *path, uint64_t seed, uint32_t *size_mb);
+// replaces the table with the POSIX shared memory segment of that name, creating it with
+// size_mb if no other process has yet. The segment is removed when the last process detaches
+// through ttable_destroy or ttable_resize
+bool ttable_attach_shared(const char *name, uint32_t size_mb, uint64_t seed, uint32_t *out_mb);
+// clears every entry, used when the previous contents are no longer relevant (ie new game).
+// The table is split between the given number of threads and the call returns once all are done.
+// A shared table is never cleared, it only moves to a new generation
+void ttable_reset(unsigned int threads);
+// the stored static evals came from another evaluation. A private table is reset, a shared one
+// is never cleared so its evals are ignored until the process detaches
+void ttable_eval_changed(unsigned int threads);
+// starts a new generation, entries from older generations are replaced first. A shared table
+// keeps its generation for the whole game
+void ttable_new_search(void);
+// mate scores are stored relative to the node and converted back using the ply of the probe
+bool ttable_probe(uint64_t key, TEntry *entry, int ply);
+// an eval of TT_NO_EVAL keeps the one already stored for the position
+void ttable_store(uint64_t	key,
+				  int		depth,
+				  int		score,
+				  int		eval,
+				  Move		best_move,
+				  BoundType	bound,
+				  int		ply);
+// permille of the entries written or hit by the current search, estimated from a sample
+int ttable_hashfull(void);
+// brings the bucket of the key into the cache ahead of a probe or store
+void ttable_prefetch(uint64_t key);
+// the TT only keeps from, to and move type, enough to identify a move within its position
+uint16_t ttable_pack_move(Move move);
 
 #endif
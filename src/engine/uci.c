@@ -24,12 +24,16 @@ void cmd_go(char **tok, int tokn);
 void cmd_stop(void);
 void cmd_debug(char **tok, int tokn);
 void cmd_print(void);
+void cmd_stats(void);
+void cmd_hash_file(UciMsgType type, char **tok, int tokn);
 
 // size_t isnt necessary here
 
 int		tokenize(char *str, const char *delim, size_t max_tok, char **out_tokens);
 bool	tok_eq(const char *str1, const char *str2);
 int		tok_search_pos(char **tok, size_t tokn, const char *str);
+int		tok_option_value_pos(char **tok, int tokn, const char *name);
+bool	tok_join(char **tok, int tokn, char *out, size_t size);
 bool	is_move_tok(const char *str);
 UciMove tok_to_move(const char *str);
 
@@ -81,6 +85,12 @@ void uci_parse(char *str) {
 		cmd_setoption(&tok[1], tokn - 1);
 	} else if (tok_eq(tok[0], "print")) {
 		cmd_print();
+	} else if (tok_eq(tok[0], "stats")) {
+		cmd_stats();
+	} else if (tok_eq(tok[0], "savehash")) {
+		cmd_hash_file(MSG_UCI_SAVEHASH, &tok[1], tokn - 1);
+	} else if (tok_eq(tok[0], "loadhash")) {
+		cmd_hash_file(MSG_UCI_LOADHASH, &tok[1], tokn - 1);
 	} else if (tok_eq(tok[0], "debug")) {
 		cmd_debug(&tok[1], tokn - 1);
 	}
@@ -114,6 +124,10 @@ void msg_free(UciMsg *msg) {
 		case MSG_UCI_DEBUG:
 			free(msg->payload.debug);
 			break;
+		case MSG_UCI_SAVEHASH:
+		case MSG_UCI_LOADHASH:
+			free(msg->payload.hash_file);
+			break;
 		default:
 			break;
 	}
@@ -135,6 +149,10 @@ UciMsg msg_create(UciMsgType type) {
 		case MSG_UCI_SETOPTION:
 			arg_size = sizeof(UciSetOption);
 			break;
+		case MSG_UCI_SAVEHASH:
+		case MSG_UCI_LOADHASH:
+			arg_size = sizeof(UciHashFile);
+			break;
 		default:
 			break;
 	}
@@ -174,19 +192,137 @@ void cmd_print(void) {
 	engmq_send_uci_msg(&msg);
 }
 
+void cmd_stats(void) {
+	log_trace("cmd_stats");
+	UciMsg msg = msg_create(MSG_UCI_STATS);
+	engmq_send_uci_msg(&msg);
+}
+
+// the path is everything after the command, tokenizing split it on any spaces it contained
+void cmd_hash_file(UciMsgType type, char **tok, int tokn) {
+	log_trace("cmd_hash_file");
+	if (tokn < 1) {
+		uci_print("info string Missing snapshot file");
+		return;
+	}
+	UciMsg msg = msg_create(type);
+	if (!tok_join(tok, tokn, msg.payload.hash_file->path, UCI_PATH_LIMIT)) {
+		uci_print("info string Snapshot path too long");
+		msg.free_payload(&msg);
+		return;
+	}
+	engmq_send_uci_msg(&msg);
+}
+
 void cmd_setoption(char **tok, int tokn) {
 	log_trace("cmd_setoption");
 	if (!tok_eq(tok[0], "name"))
 		return;
-	int threads_pos = tok_search_pos(tok, tokn, "Threads");
+	// buttons dont carry a value
+	if (tokn >= 3 && tok_eq(tok[1], "Clear") && tok_eq(tok[2], "Hash")) {
+		UciMsg msg					 = msg_create(MSG_UCI_SETOPTION);
+		msg.payload.set_option->type = OPT_CLEAR_HASH;
+		engmq_send_uci_msg(&msg);
+		return;
+	}
+
+	int threads_pos = tok_option_value_pos(tok, tokn, "Threads");
 	if (threads_pos != -1) {
-		if (!tok_eq(tok[threads_pos + 1], "value"))
+		UciMsg msg							= msg_create(MSG_UCI_SETOPTION);
+		msg.payload.set_option->type		= OPT_THREADS;
+		msg.payload.set_option->opt.threads = strtoul(tok[threads_pos], NULL, 10);
+		engmq_send_uci_msg(&msg);
+		return;
+	}
+
+	int mode_pos = tok_option_value_pos(tok, tokn, "ParallelMode");
+	if (mode_pos != -1) {
+		UciParallelMode mode;
+		if (tok_eq(tok[mode_pos], "SharedTT")) {
+			mode = UCI_PARALLEL_SHARED_TT;
+		} else if (tok_eq(tok[mode_pos], "ABDADA")) {
+			mode = UCI_PARALLEL_ABDADA;
+		} else {
+			uci_print("info string Unknown ParallelMode %s", tok[mode_pos]);
+			return;
+		}
+		UciMsg msg								  = msg_create(MSG_UCI_SETOPTION);
+		msg.payload.set_option->type			  = OPT_PARALLEL_MODE;
+		msg.payload.set_option->opt.parallel_mode = mode;
+		engmq_send_uci_msg(&msg);
+		return;
+	}
+
+	int margin_pos = tok_option_value_pos(tok, tokn, "ProbCutMargin");
+	if (margin_pos != -1) {
+		UciMsg msg								   = msg_create(MSG_UCI_SETOPTION);
+		msg.payload.set_option->type			   = OPT_PROBCUT_MARGIN;
+		msg.payload.set_option->opt.probcut_margin = strtoul(tok[margin_pos], NULL, 10);
+		engmq_send_uci_msg(&msg);
+		return;
+	}
+
+	int depth_pos = tok_option_value_pos(tok, tokn, "ProbCutDepth");
+	if (depth_pos != -1) {
+		UciMsg msg								  = msg_create(MSG_UCI_SETOPTION);
+		msg.payload.set_option->type			  = OPT_PROBCUT_DEPTH;
+		msg.payload.set_option->opt.probcut_depth = strtoul(tok[depth_pos], NULL, 10);
+		engmq_send_uci_msg(&msg);
+		return;
+	}
+
+	int det_pos = tok_option_value_pos(tok, tokn, "Deterministic");
+	if (det_pos != -1) {
+		UciMsg msg								  = msg_create(MSG_UCI_SETOPTION);
+		msg.payload.set_option->type			  = OPT_DETERMINISTIC;
+		msg.payload.set_option->opt.deterministic = tok_eq(tok[det_pos], "true");
+		engmq_send_uci_msg(&msg);
+		return;
+	}
+
+	int shared_pos = tok_option_value_pos(tok, tokn, "SharedHash");
+	if (shared_pos != -1) {
+		const char *name			 = tok_eq(tok[shared_pos], "<empty>") ? "" : tok[shared_pos];
+		UciMsg		msg				 = msg_create(MSG_UCI_SETOPTION);
+		msg.payload.set_option->type = OPT_SHARED_HASH;
+		snprintf(msg.payload.set_option->opt.shared_hash, UCI_PATH_LIMIT, "%s", name);
+		engmq_send_uci_msg(&msg);
+		return;
+	}
+
+	int nnue_pos = tok_option_value_pos(tok, tokn, "UseNNUE");
+	if (nnue_pos != -1) {
+		UciMsg msg							 = msg_create(MSG_UCI_SETOPTION);
+		msg.payload.set_option->type		 = OPT_USE_NNUE;
+		msg.payload.set_option->opt.use_nnue = tok_eq(tok[nnue_pos], "true");
+		engmq_send_uci_msg(&msg);
+		return;
+	}
+
+	// like the snapshot paths, the path is every token after value
+	int file_pos = tok_option_value_pos(tok, tokn, "EvalFile");
+	if (file_pos != -1) {
+		UciMsg msg					 = msg_create(MSG_UCI_SETOPTION);
+		msg.payload.set_option->type = OPT_EVAL_FILE;
+		char *path					 = msg.payload.set_option->opt.eval_file;
+		if (!tok_join(&tok[file_pos], tokn - file_pos, path, UCI_PATH_LIMIT)) {
+			uci_print("info string EvalFile path too long");
+			msg.free_payload(&msg);
 			return;
+		}
+		if (tok_eq(path, "<empty>"))
+			path[0] = '\0';
+		engmq_send_uci_msg(&msg);
+		return;
+	}
 
+	int hash_pos = tok_option_value_pos(tok, tokn, "Hash");
+	if (hash_pos != -1) {
 		UciMsg msg							= msg_create(MSG_UCI_SETOPTION);
-		msg.payload.set_option->type		= OPT_THREADS;
-		msg.payload.set_option->opt.threads = strtoul(tok[threads_pos + 2], NULL, 10);
+		msg.payload.set_option->type		= OPT_HASH;
+		msg.payload.set_option->opt.hash_mb = strtoul(tok[hash_pos], NULL, 10);
 		engmq_send_uci_msg(&msg);
+		return;
 	}
 }
 
@@ -454,6 +590,27 @@ int tok_search_pos(char **tok, size_t tokn, const char *str) {
 	return -1;
 }
 
+// returns the position of the value token in "<name> value <value>", -1 if not found
+int tok_option_value_pos(char **tok, int tokn, const char *name) {
+	int name_pos = tok_search_pos(tok, tokn, name);
+	if (name_pos == -1 || name_pos + 2 >= tokn || !tok_eq(tok[name_pos + 1], "value"))
+		return -1;
+	return name_pos + 2;
+}
+
+// the tokens joined back with single spaces, false if they dont fit into size bytes
+bool tok_join(char **tok, int tokn, char *out, size_t size) {
+	size_t len = 0;
+	out[0]	   = '\0';
+	for (int i = 0; i < tokn; i++) {
+		int written = snprintf(out + len, size - len, i ? " %s" : "%s", tok[i]);
+		if (written < 0 || (size_t) written >= size - len)
+			return false;
+		len += written;
+	}
+	return true;
+}
+
 bool is_move_tok(const char *str) {
 	size_t len = strlen(str);
 	if (len < 4 || len > 6) {
@@ -21,8 +21,19 @@ VECTOR_DEFINE_TYPE(UciMove, UciMoveList, ucimv_list);
 typedef enum set_option_type {
 	OPT_NONE,
 	OPT_THREADS,
+	OPT_PARALLEL_MODE,
+	OPT_PROBCUT_MARGIN,
+	OPT_PROBCUT_DEPTH,
+	OPT_DETERMINISTIC,
+	OPT_HASH,
+	OPT_CLEAR_HASH,
+	OPT_SHARED_HASH,
+	OPT_USE_NNUE,
+	OPT_EVAL_FILE,
 } UciSetOptionType;
 
+typedef enum { UCI_PARALLEL_SHARED_TT, UCI_PARALLEL_ABDADA } UciParallelMode;
+
 typedef struct {
 	FenString	fen;
 	UciMoveList moves;
@@ -47,11 +58,25 @@ typedef struct {
 	bool debug;
 } UciDebug;
 
+#define UCI_PATH_LIMIT 1024
+
+typedef struct {
+	char path[UCI_PATH_LIMIT];
+} UciHashFile;
+
 typedef struct {
 	UciSetOptionType type;
 
 	union {
-		int threads;
+		int				threads;
+		UciParallelMode parallel_mode;
+		int				probcut_margin;
+		int				probcut_depth;
+		bool			deterministic;
+		int				hash_mb;
+		char			shared_hash[UCI_PATH_LIMIT];  // empty to go back to a private table
+		bool			use_nnue;
+		char			eval_file[UCI_PATH_LIMIT];	// network file, empty if there is none
 	} opt;
 } UciSetOption;
 
@@ -74,7 +99,10 @@ typedef enum uci_msg_type {
 	MSG_UCI_STOP,
 	MSG_UCI_SETOPTION,
 	MSG_UCI_DEBUG,
-	MSG_UCI_PRINT
+	MSG_UCI_PRINT,
+	MSG_UCI_STATS,
+	MSG_UCI_SAVEHASH,
+	MSG_UCI_LOADHASH
 } UciMsgType;
 
 typedef struct uci_msg {
@@ -85,6 +113,7 @@ typedef struct uci_msg {
 		UciGo		 *go;
 		UciSetOption *set_option;
 		UciDebug	 *debug;
+		UciHashFile	 *hash_file;
 	} payload;
 
 	void (*free_payload)(struct uci_msg *msg);
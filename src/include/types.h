@@ -99,6 +99,8 @@ typedef struct {
 	uint16_t fullmove_counter;
 	Player	 side;
 	uint64_t hash;
+	uint64_t pawn_hash;
+	uint64_t material;
 } History;
 
 typedef struct {
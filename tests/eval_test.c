@@ -0,0 +1,174 @@
+#include "eval.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../external/unity/unity.h"
+#include "bitboards.h"
+#include "board.h"
+#include "hash.h"
+#include "pawn.h"
+#include "types.h"
+
+Board *board = NULL;
+Board *other = NULL;
+
+// openings, middlegames and endgames so that both stages of the tables weigh in
+const char *positions[] = {
+	"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+	"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+	"r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N2N2/PP2BPPP/R2QKB1R b KQ - 3 8",
+	"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+	"4k3/5p2/8/3N4/8/2B5/1P3PP1/6K1 b - - 0 40",
+	"6k1/5ppp/8/8/8/8/q4PPP/3R2K1 w - - 0 30",
+};
+
+void setUp(void) {
+	board = board_create();
+	other = board_create();
+}
+
+void tearDown(void) {
+	board_destroy(&board);
+	board_destroy(&other);
+}
+
+// flips the ranks and swaps the colors, the mirrored position is the same for the other side
+static void mirror_fen(const char *fen, char *out) {
+	char placement[128], side, castling[8], ep[4];
+	int	 halfmove, fullmove;
+	sscanf(fen, "%127s %c %7s %3s %d %d", placement, &side, castling, ep, &halfmove, &fullmove);
+
+	char *ranks[8];
+	int	  n = 0;
+	for (char *tok = strtok(placement, "/"); tok && n < 8; tok = strtok(NULL, "/")) {
+		ranks[n++] = tok;
+	}
+	out[0] = '\0';
+	for (int r = n - 1; r >= 0; r--) {
+		for (char *c = ranks[r]; *c; c++) {
+			*c = isupper(*c) ? tolower(*c) : toupper(*c);
+		}
+		strcat(out, ranks[r]);
+		if (r > 0)
+			strcat(out, "/");
+	}
+
+	char rights[8] = "-";
+	if (castling[0] != '-') {
+		int i = 0;
+		for (const char *c = castling; *c; c++) {
+			if (islower(*c))
+				rights[i++] = toupper(*c);
+		}
+		for (const char *c = castling; *c; c++) {
+			if (isupper(*c))
+				rights[i++] = tolower(*c);
+		}
+		rights[i] = '\0';
+	}
+	if (ep[0] != '-')
+		ep[1] = ep[1] == '3' ? '6' : '3';
+	sprintf(out + strlen(out), " %c %s %s %d %d", side == 'w' ? 'b' : 'w', rights, ep, halfmove,
+			fullmove);
+}
+
+void test_mirrored_positions_evaluate_the_same(void) {
+	for (size_t p = 0; p < sizeof(positions) / sizeof(positions[0]); p++) {
+		char fen[128];
+		mirror_fen(positions[p], fen);
+		TEST_ASSERT_TRUE(board_from_fen(board, positions[p]));
+		TEST_ASSERT_TRUE(board_from_fen(other, fen));
+		TEST_ASSERT_EQUAL_MESSAGE(eval(board), eval(other), fen);
+	}
+}
+
+void test_side_to_move_flips_the_sign(void) {
+	TEST_ASSERT_TRUE(board_from_fen(board, "4k3/5p2/8/3N4/8/2B5/1P3PP1/6K1 w - - 0 40"));
+	TEST_ASSERT_TRUE(board_from_fen(other, "4k3/5p2/8/3N4/8/2B5/1P3PP1/6K1 b - - 0 40"));
+	TEST_ASSERT_EQUAL(eval(board), -eval(other));
+}
+
+void test_king_prefers_shelter_with_queens_and_center_without(void) {
+	const char *castled = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQ1RK1 w kq - 0 1";
+	const char *exposed = "rnbqkbnr/pppppppp/8/8/8/4K3/PPPPPPPP/RNBQ1R2 w kq - 0 1";
+	TEST_ASSERT_TRUE(board_from_fen(board, castled));
+	TEST_ASSERT_TRUE(board_from_fen(other, exposed));
+	TEST_ASSERT_GREATER_THAN(eval(other), eval(board));
+
+	const char *central = "4k3/pp6/8/8/8/4K3/6PP/8 w - - 0 1";
+	const char *corner	= "4k3/pp6/8/8/8/8/6PP/6K1 w - - 0 1";
+	TEST_ASSERT_TRUE(board_from_fen(board, central));
+	TEST_ASSERT_TRUE(board_from_fen(other, corner));
+	TEST_ASSERT_GREATER_THAN(eval(other), eval(board));
+}
+
+static int piece_terms(const char *fen) {
+	TEST_ASSERT_TRUE_MESSAGE(board_from_fen(board, fen), fen);
+	return pawn_piece_terms(board, pawn_probe(board));
+}
+
+void test_outposts_and_free_passers_come_from_the_pawn_structure(void) {
+	// the c7 pawn can chase the knight away, the b7 pawn cant
+	const char *outpost = "4k3/1p6/8/3N4/4P3/8/8/4K3 w - - 0 1";
+	const char *chased	= "4k3/2p5/8/3N4/4P3/8/8/4K3 w - - 0 1";
+	TEST_ASSERT_GREATER_THAN(piece_terms(chased), piece_terms(outpost));
+
+	const char *unblocked = "8/8/8/4P3/8/4k3/8/4K3 w - - 0 1";
+	const char *blocked	  = "8/8/4k3/4P3/8/8/8/4K3 w - - 0 1";
+	TEST_ASSERT_GREATER_THAN(piece_terms(blocked), piece_terms(unblocked));
+	TEST_ASSERT_EQUAL(-piece_terms("4k3/8/8/8/4p3/8/8/4K3 w - - 0 1"),
+					  piece_terms("4k3/8/8/4P3/8/8/8/4K3 w - - 0 1"));
+}
+
+static int eval_fen(const char *fen) {
+	TEST_ASSERT_TRUE_MESSAGE(board_from_fen(board, fen), fen);
+	return eval(board);
+}
+
+void test_kbnk_drives_the_king_to_a_corner_of_the_bishop_color(void) {
+	// the bishop on e5 controls a1 and h8
+	int right = eval_fen("8/8/8/3NB3/3K4/8/k7/8 w - - 0 1");
+	int wrong = eval_fen("8/8/8/3NB3/3K4/8/7k/8 w - - 0 1");
+	TEST_ASSERT_GREATER_THAN(material_values[BISHOP] + material_values[KNIGHT], wrong);
+	TEST_ASSERT_GREATER_THAN(wrong, right);
+}
+
+void test_kpk_wins_outside_the_square_and_draws_in_the_corner(void) {
+	int win = eval_fen("k7/8/8/4P3/8/8/8/4K3 w - - 0 1");
+	TEST_ASSERT_GREATER_THAN(material_values[QUEEN], win);
+	// with the move the black king steps into the square of the pawn
+	TEST_ASSERT_LESS_THAN(material_values[ROOK], -eval_fen("k7/8/8/4P3/8/8/8/4K3 b - - 0 1"));
+	// a rook pawn cant be promoted once the defending king holds the corner
+	TEST_ASSERT_EQUAL(0, eval_fen("k7/8/8/8/8/8/P7/K7 w - - 0 1"));
+	TEST_ASSERT_EQUAL(0, eval_fen("7k/8/8/8/8/8/7P/7K b - - 0 1"));
+}
+
+void test_insufficient_material_is_a_draw(void) {
+	TEST_ASSERT_EQUAL(0, eval_fen("4k3/8/8/8/8/8/8/4KN2 w - - 0 1"));
+	TEST_ASSERT_EQUAL(0, eval_fen("4k3/8/8/8/8/8/8/4KB2 w - - 0 1"));
+	TEST_ASSERT_EQUAL(0, eval_fen("4k3/8/8/8/8/8/8/3NKN2 w - - 0 1"));
+	TEST_ASSERT_EQUAL(0, eval_fen("4kb2/8/8/8/8/8/8/4KN2 w - - 0 1"));
+}
+
+void test_only_bishops_of_both_colors_can_mate(void) {
+	// c1 and e3 are both dark, c1 and f1 are not
+	TEST_ASSERT_EQUAL(0, eval_fen("4k3/8/8/8/8/4B3/8/2B1K3 w - - 0 1"));
+	TEST_ASSERT_GREATER_THAN(material_values[QUEEN], eval_fen("4k3/8/8/8/8/8/8/2B1KB2 w - - 0 1"));
+}
+
+int main(void) {
+	bitboards_init();
+	hash_init();
+	UNITY_BEGIN();
+	RUN_TEST(test_mirrored_positions_evaluate_the_same);
+	RUN_TEST(test_side_to_move_flips_the_sign);
+	RUN_TEST(test_king_prefers_shelter_with_queens_and_center_without);
+	RUN_TEST(test_outposts_and_free_passers_come_from_the_pawn_structure);
+	RUN_TEST(test_kbnk_drives_the_king_to_a_corner_of_the_bishop_color);
+	RUN_TEST(test_kpk_wins_outside_the_square_and_draws_in_the_corner);
+	RUN_TEST(test_insufficient_material_is_a_draw);
+	RUN_TEST(test_only_bishops_of_both_colors_can_mate);
+	return UNITY_END();
+}
@@ -395,6 +395,35 @@ void test_hash_consistent_after_b_qs_castling(void) {
 	TEST_ASSERT_EQUAL_UINT64(hash_board(board), board->hash);
 }
 
+static Move test_move(Piece piece, Square from, Square to, PieceType captured, MoveType type) {
+	return (Move) {
+		.piece = piece, .captured_type = captured, .from = from, .to = to, .mv_type = type};
+}
+
+void test_pawn_and_material_keys_consistent_after_moves_and_unmake(void) {
+	board_from_fen(board, "4k3/1P6/8/3pP3/8/8/8/4K3 w - d6 0 1");
+	uint64_t start			= board->pawn_hash;
+	uint64_t start_material = board->material;
+	TEST_ASSERT_EQUAL_UINT64(hash_pawns(board), start);
+	TEST_ASSERT_EQUAL_UINT64(hash_material(board), start_material);
+
+	Piece w_pawn  = (Piece) {.player = PLAYER_W, .type = PAWN};
+	Piece b_king  = (Piece) {.player = PLAYER_B, .type = KING};
+	Move  moves[] = {test_move(w_pawn, SQ_E5, SQ_D6, PAWN, MV_EN_PASSANT),
+					 test_move(b_king, SQ_E8, SQ_F7, EMPTY, MV_QUIET),
+					 test_move(w_pawn, SQ_B7, SQ_B8, EMPTY, MV_Q_PROM)};
+	for (size_t i = 0; i < sizeof(moves) / sizeof(moves[0]); i++) {
+		TEST_ASSERT_TRUE(make_move(board, moves[i]));
+		TEST_ASSERT_EQUAL_UINT64(hash_pawns(board), board->pawn_hash);
+		TEST_ASSERT_EQUAL_UINT64(hash_material(board), board->material);
+	}
+	for (size_t i = 0; i < sizeof(moves) / sizeof(moves[0]); i++) {
+		unmake_move(board);
+	}
+	TEST_ASSERT_EQUAL_UINT64(start, board->pawn_hash);
+	TEST_ASSERT_EQUAL_UINT64(start_material, board->material);
+}
+
 int main(void) {
 	UNITY_BEGIN();
 
@@ -417,6 +446,7 @@ int main(void) {
 	RUN_TEST(test_hash_consistent_after_w_qs_castling);
 	RUN_TEST(test_hash_consistent_after_b_ks_castling);
 	RUN_TEST(test_hash_consistent_after_b_qs_castling);
+	RUN_TEST(test_pawn_and_material_keys_consistent_after_moves_and_unmake);
 
 	return UNITY_END();
 }
@@ -1167,6 +1167,31 @@ void test_b_pawn_generates_prom_moves_when_advancing_to_rank_1(void) {
 	move_list_destroy(&ml);
 }
 
+void test_noisy_moves_include_queen_promotions_and_captures_only(void) {
+	Piece pawn	 = (Piece) {.player = PLAYER_W, .type = PAWN};
+	Piece knight = (Piece) {.player = PLAYER_B, .type = KNIGHT};
+	board_set_piece(board, pawn, SQ_B7);
+	board_set_piece(board, pawn, SQ_E4);
+	board_set_piece(board, knight, SQ_D5);
+	MoveList ml;
+	move_list_init(&ml);
+	movegen_generate_noisy(board, pawn.player, &ml);
+	TEST_ASSERT_EQUAL(2, move_list_size(&ml));
+	TEST_ASSERT_TRUE(move_list_contains(&ml,
+										(Move) {.from		   = SQ_B7,
+												.to			   = SQ_B8,
+												.mv_type	   = MV_Q_PROM,
+												.piece		   = pawn,
+												.captured_type = EMPTY}));
+	TEST_ASSERT_TRUE(move_list_contains(&ml,
+										(Move) {.from		   = SQ_E4,
+												.to			   = SQ_D5,
+												.mv_type	   = MV_CAPTURE,
+												.piece		   = pawn,
+												.captured_type = KNIGHT}));
+	move_list_free(&ml);
+}
+
 int main(void) {
 	UNITY_BEGIN();
 	RUN_TEST(test_white_pawns_have_two_moves_at_starting_row);
@@ -1198,6 +1223,7 @@ int main(void) {
 	RUN_TEST(test_black_qs_castling_move_is_prevented_when_blocked);
 	RUN_TEST(test_w_pawn_generates_prom_moves_when_advancing_to_rank_8);
 	RUN_TEST(test_b_pawn_generates_prom_moves_when_advancing_to_rank_1);
+	RUN_TEST(test_noisy_moves_include_queen_promotions_and_captures_only);
 
 	return UNITY_END();
 }
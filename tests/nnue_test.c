@@ -0,0 +1,227 @@
+#include "nnue.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../external/unity/unity.h"
+#include "bitboards.h"
+#include "board.h"
+#include "hash.h"
+#include "makemove.h"
+#include "movegen.h"
+#include "types.h"
+
+#define NETWORK_PATH  "/tmp/chess_nnue_test.nnue"
+#define WALK_DEPTH	  2
+#define PLAYOUT_PLIES 120
+
+Board	  *board = NULL;
+NnueState *state = NULL;
+
+// castling, en passant and promotions all show up within a few plies of these
+const char *positions[] = {
+	"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+	"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+	"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+	"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+	"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+};
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t rng(void) {
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+static int rng_range(int lo, int hi) {
+	return lo + (int) (rng() % (uint64_t) (hi - lo + 1));
+}
+
+// small random weights keep the accumulators far from overflowing, the tests only need the
+// incremental and the full computations to agree
+static bool write_network(const char *path) {
+	FILE *f = fopen(path, "wb");
+	if (!f)
+		return false;
+	NnueHeader header = {.magic	   = NNUE_MAGIC,
+						 .version  = NNUE_VERSION,
+						 .features = NNUE_FEATURES,
+						 .hidden   = NNUE_HIDDEN,
+						 .scale	   = 400};
+	fwrite(&header, sizeof(header), 1, f);
+	int16_t bias[NNUE_HIDDEN];
+	for (int i = 0; i < NNUE_HIDDEN; i++) {
+		bias[i] = rng_range(-64, 64);
+	}
+	fwrite(bias, sizeof(bias), 1, f);
+	size_t	 count	 = (size_t) NNUE_FEATURES * NNUE_HIDDEN;
+	int16_t *weights = malloc(count * sizeof(int16_t));
+	if (!weights) {
+		fclose(f);
+		return false;
+	}
+	for (size_t i = 0; i < count; i++) {
+		weights[i] = rng_range(-32, 32);
+	}
+	fwrite(weights, sizeof(int16_t), count, f);
+	free(weights);
+	int8_t output[2 * NNUE_HIDDEN];
+	for (int i = 0; i < 2 * NNUE_HIDDEN; i++) {
+		output[i] = rng_range(-127, 127);
+	}
+	fwrite(output, sizeof(output), 1, f);
+	int32_t output_bias = 1234;
+	fwrite(&output_bias, sizeof(output_bias), 1, f);
+	return fclose(f) == 0;
+}
+
+void setUp(void) {
+	board = board_create();
+	state = nnue_state_create();
+}
+
+void tearDown(void) {
+	nnue_state_destroy(&state);
+	board_destroy(&board);
+}
+
+static void assert_matches_refresh(void) {
+	NnueAccumulator fresh;
+	nnue_refresh(board, &fresh);
+	TEST_ASSERT_EQUAL_MEMORY(&fresh, &state->stack[state->top], sizeof(fresh));
+}
+
+static void walk(int depth) {
+	assert_matches_refresh();
+	if (depth == 0)
+		return;
+	MoveList *moves = movegen_generate(board, board->side);
+	for (size_t i = 0; i < move_list_size(moves); i++) {
+		if (!make_move(board, *move_list_at(moves, i)))
+			continue;
+		walk(depth - 1);
+		unmake_move(board);
+		assert_matches_refresh();
+	}
+	move_list_destroy(&moves);
+}
+
+void test_incremental_updates_match_refresh_on_every_move(void) {
+	for (size_t p = 0; p < sizeof(positions) / sizeof(positions[0]); p++) {
+		TEST_ASSERT_TRUE(board_from_fen(board, positions[p]));
+		nnue_attach(board, state);
+		walk(WALK_DEPTH);
+		TEST_ASSERT_EQUAL(0, state->top);
+		nnue_detach(board);
+	}
+}
+
+void test_incremental_updates_match_refresh_along_playouts(void) {
+	for (size_t p = 0; p < sizeof(positions) / sizeof(positions[0]); p++) {
+		TEST_ASSERT_TRUE(board_from_fen(board, positions[p]));
+		nnue_attach(board, state);
+		int plies = 0;
+		for (; plies < PLAYOUT_PLIES; plies++) {
+			MoveList *moves = movegen_generate(board, board->side);
+			size_t	  n		= move_list_size(moves);
+			bool	  moved = false;
+			// try the moves from a random start until one is legal
+			for (size_t i = 0, start = n ? rng() % n : 0; i < n && !moved; i++) {
+				moved = make_move(board, *move_list_at(moves, (start + i) % n));
+			}
+			move_list_destroy(&moves);
+			if (!moved)
+				break;
+			assert_matches_refresh();
+		}
+		for (; plies > 0; plies--) {
+			unmake_move(board);
+			assert_matches_refresh();
+		}
+		nnue_detach(board);
+	}
+}
+
+// movegen doesnt generate en passant captures, so the walks above never make one
+void test_en_passant_updates_match_refresh(void) {
+	TEST_ASSERT_TRUE(board_from_fen(board, "4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 2"));
+	nnue_attach(board, state);
+	Move ep = {.piece		  = {.type = PAWN, .player = PLAYER_W},
+			   .from		  = SQ_E5,
+			   .to			  = SQ_D6,
+			   .mv_type		  = MV_EN_PASSANT,
+			   .captured_type = PAWN};
+	TEST_ASSERT_TRUE(make_move(board, ep));
+	assert_matches_refresh();
+	unmake_move(board);
+	assert_matches_refresh();
+	nnue_detach(board);
+}
+
+void test_evaluation_matches_without_accumulators(void) {
+	for (size_t p = 0; p < sizeof(positions) / sizeof(positions[0]); p++) {
+		TEST_ASSERT_TRUE(board_from_fen(board, positions[p]));
+		int detached = nnue_evaluate(board);
+		nnue_attach(board, state);
+		TEST_ASSERT_EQUAL(detached, nnue_evaluate(board));
+		nnue_detach(board);
+	}
+}
+
+void test_simd_kernels_match_scalar(void) {
+	NnueSimd best = nnue_simd();
+	int		 expected[sizeof(positions) / sizeof(positions[0])];
+	TEST_ASSERT_TRUE(nnue_use_simd(NNUE_SIMD_SCALAR));
+	for (size_t p = 0; p < sizeof(positions) / sizeof(positions[0]); p++) {
+		TEST_ASSERT_TRUE(board_from_fen(board, positions[p]));
+		expected[p] = nnue_evaluate(board);
+	}
+	for (NnueSimd simd = NNUE_SIMD_SSE41; simd <= NNUE_SIMD_AVX2; simd++) {
+		if (!nnue_use_simd(simd))
+			continue;
+		for (size_t p = 0; p < sizeof(positions) / sizeof(positions[0]); p++) {
+			TEST_ASSERT_TRUE(board_from_fen(board, positions[p]));
+			TEST_ASSERT_EQUAL(expected[p], nnue_evaluate(board));
+		}
+	}
+	TEST_ASSERT_TRUE(nnue_use_simd(best));
+}
+
+void test_invalid_network_keeps_the_loaded_one(void) {
+	const char *path = NETWORK_PATH ".short";
+	FILE	   *f	 = fopen(path, "wb");
+	TEST_ASSERT_NOT_NULL(f);
+	fwrite(NNUE_MAGIC, sizeof(NNUE_MAGIC), 1, f);
+	fclose(f);
+	TEST_ASSERT_TRUE(board_from_fen(board, positions[0]));
+	int before = nnue_evaluate(board);
+	TEST_ASSERT_FALSE(nnue_load(path));
+	TEST_ASSERT_TRUE(nnue_active());
+	TEST_ASSERT_EQUAL(before, nnue_evaluate(board));
+	unlink(path);
+}
+
+int main(void) {
+	bitboards_init();
+	hash_init();
+	if (!write_network(NETWORK_PATH) || !nnue_load(NETWORK_PATH)) {
+		unlink(NETWORK_PATH);
+		return 1;
+	}
+	UNITY_BEGIN();
+	RUN_TEST(test_incremental_updates_match_refresh_on_every_move);
+	RUN_TEST(test_incremental_updates_match_refresh_along_playouts);
+	RUN_TEST(test_en_passant_updates_match_refresh);
+	RUN_TEST(test_evaluation_matches_without_accumulators);
+	RUN_TEST(test_simd_kernels_match_scalar);
+	RUN_TEST(test_invalid_network_keeps_the_loaded_one);
+	int failures = UNITY_END();
+	nnue_unload();
+	unlink(NETWORK_PATH);
+	return failures;
+}
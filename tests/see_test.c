@@ -0,0 +1,100 @@
+#include "see.h"
+
+#include "../external/unity/unity.h"
+#include "bitboards.h"
+#include "board.h"
+#include "movegen.h"
+#include "movelist.h"
+#include "types.h"
+
+Board *board = NULL;
+
+void setUp(void) {
+	board = board_create();
+}
+
+void tearDown(void) {
+	board_destroy(&board);
+}
+
+// the move as movegen generates it, so the captured piece and the move type are filled in
+static Move find_move(const char *fen, Square from, Square to, MoveType type) {
+	TEST_ASSERT_TRUE(board_from_fen(board, fen));
+	MoveList *moves = movegen_generate(board, board->side);
+	Move	  found = NO_MOVE;
+	for (size_t i = 0; i < move_list_size(moves); i++) {
+		Move mv = *move_list_at(moves, i);
+		if (mv.from == from && mv.to == to && mv.mv_type == type)
+			found = mv;
+	}
+	move_list_destroy(&moves);
+	TEST_ASSERT_EQUAL_MESSAGE(from, found.from, "move not generated");
+	return found;
+}
+
+void test_undefended_capture_wins_the_piece(void) {
+	Move mv = find_move("4k3/8/8/3p4/8/8/8/3RK3 w - - 0 1", SQ_D1, SQ_D5, MV_CAPTURE);
+	TEST_ASSERT_EQUAL(100, see(board, mv));
+	TEST_ASSERT_TRUE(see_ge(board, mv, 0));
+}
+
+void test_capturing_a_defended_pawn_loses_the_knight(void) {
+	Move mv = find_move("4k3/8/2p5/3p4/8/4N3/8/4K3 w - - 0 1", SQ_E3, SQ_D5, MV_CAPTURE);
+	TEST_ASSERT_EQUAL(100 - 320, see(board, mv));
+	TEST_ASSERT_FALSE(see_ge(board, mv, 0));
+}
+
+void test_defended_piece_traded_for_a_cheaper_attacker(void) {
+	// pawn takes knight, knight takes back
+	Move mv = find_move("4k3/8/5n2/3n4/4P3/8/8/4K3 w - - 0 1", SQ_E4, SQ_D5, MV_CAPTURE);
+	TEST_ASSERT_EQUAL(320 - 100, see(board, mv));
+}
+
+void test_quiet_move_to_an_attacked_square(void) {
+	Move mv = find_move("4k3/8/2p5/8/8/8/8/3RK3 w - - 0 1", SQ_D1, SQ_D5, MV_QUIET);
+	TEST_ASSERT_EQUAL(-500, see(board, mv));
+}
+
+void test_xray_attacker_behind_the_capturing_rook(void) {
+	// the queen recaptures through the file the rook opened
+	Move mv = find_move("3rk3/8/8/3r4/8/8/3R4/3QK3 w - - 0 1", SQ_D2, SQ_D5, MV_CAPTURE);
+	TEST_ASSERT_EQUAL(500, see(board, mv));
+}
+
+void test_xray_defender_behind_the_recapturing_rook(void) {
+	// without the queen behind the rook on d7 black couldnt afford to recapture
+	Move mv = find_move("3qk3/3r4/8/3n4/8/8/3R4/3QK3 w - - 0 1", SQ_D2, SQ_D5, MV_CAPTURE);
+	TEST_ASSERT_EQUAL(320 - 500, see(board, mv));
+	mv = find_move("4k3/3r4/8/3n4/8/8/3R4/3QK3 w - - 0 1", SQ_D2, SQ_D5, MV_CAPTURE);
+	TEST_ASSERT_EQUAL(320, see(board, mv));
+}
+
+void test_bishop_xray_on_the_diagonal(void) {
+	// the bishop behind the queen joins once the queen has taken
+	Move mv = find_move("4k3/8/5p2/4p3/3Q4/2B5/8/4K3 w - - 0 1", SQ_D4, SQ_E5, MV_CAPTURE);
+	TEST_ASSERT_EQUAL(100 - 900 + 100, see(board, mv));
+}
+
+void test_promotion_capture(void) {
+	Move mv = find_move("1n2k3/P7/8/8/8/8/8/4K3 w - - 0 1", SQ_A7, SQ_B8, MV_Q_PROM_CAPTURE);
+	TEST_ASSERT_EQUAL(320 + 900 - 100, see(board, mv));
+	// the king takes the new queen, the knight is still won for the pawn
+	mv = find_move("1nk5/P7/8/8/8/8/8/4K3 w - - 0 1", SQ_A7, SQ_B8, MV_Q_PROM_CAPTURE);
+	TEST_ASSERT_EQUAL(320 - 100, see(board, mv));
+	TEST_ASSERT_TRUE(see_ge(board, mv, 200));
+	TEST_ASSERT_FALSE(see_ge(board, mv, 300));
+}
+
+int main(void) {
+	bitboards_init();
+	UNITY_BEGIN();
+	RUN_TEST(test_undefended_capture_wins_the_piece);
+	RUN_TEST(test_capturing_a_defended_pawn_loses_the_knight);
+	RUN_TEST(test_defended_piece_traded_for_a_cheaper_attacker);
+	RUN_TEST(test_quiet_move_to_an_attacked_square);
+	RUN_TEST(test_xray_attacker_behind_the_capturing_rook);
+	RUN_TEST(test_xray_defender_behind_the_recapturing_rook);
+	RUN_TEST(test_bishop_xray_on_the_diagonal);
+	RUN_TEST(test_promotion_capture);
+	return UNITY_END();
+}
@@ -0,0 +1,353 @@
+#include "transposition.h"
+
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <threads.h>
+#include <unistd.h>
+
+#include "../external/unity/unity.h"
+#include "search_types.h"
+#include "types.h"
+
+#define TT_SIZE_MB		 1
+#define TORTURE_THREADS	 8
+#define TORTURE_ITERS	 200000
+#define TORTURE_BUCKETS	 64	 // few buckets so the threads keep fighting over the same entries
+#define TORTURE_TAG_BITS 10
+#define SHARED_NAME		 "/chess_transposition_test"
+#define SHARED_SEED		 0x1234
+
+atomic_int torture_hits;
+atomic_int torture_corrupt;
+
+void setUp(void) {
+	ttable_init(TT_SIZE_MB, 1);
+}
+
+void tearDown(void) {
+	ttable_destroy();
+}
+
+// with a power of two number of buckets the low bits select the bucket, the tag in the upper
+// bits tells apart keys sharing it
+static uint64_t bucket_key(uint16_t tag, uint32_t bucket) {
+	return (uint64_t) tag << 48 | bucket;
+}
+
+static uint64_t mix(uint64_t x) {
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+// every field of the stored entry derives from the key so a reader can validate what it gets
+static Move key_move(uint64_t key) {
+	uint64_t h	  = mix(key);
+	Square	 from = h & 0x3F;
+	return (Move) {.from		  = from,
+				   .to			  = (from + 1 + (h >> 6) % 63) % SQ_CNT,
+				   .mv_type		  = (h >> 12) % MOVE_TYPE_CNT,
+				   .piece		  = {.type = PAWN, .player = PLAYER_W},
+				   .captured_type = EMPTY};
+}
+
+static int key_depth(uint64_t key) {
+	return (mix(key) >> 20) % 60;
+}
+
+static int key_score(uint64_t key) {
+	return (int) ((mix(key) >> 28) % 20000) - 10000;
+}
+
+static BoundType key_bound(uint64_t key) {
+	return (mix(key) >> 44) % 3;
+}
+
+static int key_eval(uint64_t key) {
+	return (int) ((mix(key) >> 46) % 4000) - 2000;
+}
+
+static int torture_thread(void *arg) {
+	uint64_t rng = mix((uintptr_t) arg + 1);
+	for (int i = 0; i < TORTURE_ITERS; i++) {
+		rng			 = mix(rng);
+		uint16_t tag = 1 + (rng & ((1 << TORTURE_TAG_BITS) - 1));
+		uint64_t key = bucket_key(tag, (rng >> 16) % TORTURE_BUCKETS);
+		if (rng >> 63) {
+			ttable_store(key,
+						 key_depth(key),
+						 key_score(key),
+						 key_eval(key),
+						 key_move(key),
+						 key_bound(key),
+						 0);
+			continue;
+		}
+		TEntry e = {0};
+		if (!ttable_probe(key, &e, 0))
+			continue;
+		atomic_fetch_add(&torture_hits, 1);
+		// an eval read while another store replaces the entry comes back unknown, never wrong
+		bool eval_ok = e.eval == key_eval(key) || e.eval == TT_NO_EVAL;
+		if (e.depth != key_depth(key) || e.score != key_score(key) || !eval_ok ||
+			e.move != ttable_pack_move(key_move(key)) || e.bound != key_bound(key))
+			atomic_fetch_add(&torture_corrupt, 1);
+	}
+	return 0;
+}
+
+void test_probe_returns_stored_entry(void) {
+	uint64_t key = bucket_key(42, 7);
+	Move	 mv	 = key_move(key);
+	ttable_store(key, 5, 123, -45, mv, BOUND_EXACT, 0);
+
+	TEntry e = {0};
+	TEST_ASSERT_TRUE(ttable_probe(key, &e, 0));
+	TEST_ASSERT_EQUAL(5, e.depth);
+	TEST_ASSERT_EQUAL(123, e.score);
+	TEST_ASSERT_EQUAL(-45, e.eval);
+	TEST_ASSERT_EQUAL(BOUND_EXACT, e.bound);
+	TEST_ASSERT_EQUAL_UINT16(ttable_pack_move(mv), e.move);
+}
+
+void test_probe_misses_other_key_in_same_bucket(void) {
+	ttable_store(bucket_key(1, 3), 5, 10, TT_NO_EVAL, key_move(1), BOUND_LOWER, 0);
+	TEntry e = {0};
+	TEST_ASSERT_FALSE(ttable_probe(bucket_key(2, 3), &e, 0));
+}
+
+void test_mate_scores_are_relative_to_the_node(void) {
+	uint64_t key = bucket_key(9, 1);
+	ttable_store(key, 3, CHECKMATE - 5, TT_NO_EVAL, NO_MOVE, BOUND_EXACT, 3);
+	TEntry e = {0};
+	TEST_ASSERT_TRUE(ttable_probe(key, &e, 1));
+	TEST_ASSERT_EQUAL(CHECKMATE - 3, e.score);
+
+	ttable_store(key, 4, -CHECKMATE + 6, TT_NO_EVAL, NO_MOVE, BOUND_EXACT, 4);
+	TEST_ASSERT_TRUE(ttable_probe(key, &e, 2));
+	TEST_ASSERT_EQUAL(-CHECKMATE + 4, e.score);
+}
+
+void test_shallower_store_keeps_deeper_entry(void) {
+	uint64_t key = bucket_key(5, 2);
+	ttable_store(key, 8, 50, TT_NO_EVAL, key_move(key), BOUND_EXACT, 0);
+	ttable_store(key, 2, -50, TT_NO_EVAL, NO_MOVE, BOUND_UPPER, 0);
+	TEntry e = {0};
+	TEST_ASSERT_TRUE(ttable_probe(key, &e, 0));
+	TEST_ASSERT_EQUAL(8, e.depth);
+	TEST_ASSERT_EQUAL(50, e.score);
+}
+
+void test_store_without_eval_keeps_known_eval(void) {
+	uint64_t key = bucket_key(6, 4);
+	ttable_store(key, 0, 30, 25, NO_MOVE, BOUND_LOWER, 0);
+	ttable_store(key, 6, 70, TT_NO_EVAL, key_move(key), BOUND_EXACT, 0);
+	TEntry e = {0};
+	TEST_ASSERT_TRUE(ttable_probe(key, &e, 0));
+	TEST_ASSERT_EQUAL(6, e.depth);
+	TEST_ASSERT_EQUAL(25, e.eval);
+
+	ttable_store(bucket_key(7, 4), 3, 0, TT_NO_EVAL, NO_MOVE, BOUND_EXACT, 0);
+	TEST_ASSERT_TRUE(ttable_probe(bucket_key(7, 4), &e, 0));
+	TEST_ASSERT_EQUAL(TT_NO_EVAL, e.eval);
+}
+
+void test_full_bucket_replaces_shallowest_entry(void) {
+	// fill a bucket with depths 1..n, the next position evicts the depth 1 entry
+	int n = 1;
+	for (; n <= 16; n++) {
+		ttable_store(bucket_key(n, 0), n, 0, TT_NO_EVAL, NO_MOVE, BOUND_EXACT, 0);
+		TEntry e = {0};
+		if (!ttable_probe(bucket_key(1, 0), &e, 0))
+			break;
+	}
+	TEST_ASSERT_TRUE(n > 2);
+	TEntry e = {0};
+	TEST_ASSERT_FALSE(ttable_probe(bucket_key(1, 0), &e, 0));
+	for (int tag = 2; tag <= n; tag++) {
+		TEST_ASSERT_TRUE(ttable_probe(bucket_key(tag, 0), &e, 0));
+	}
+}
+
+void test_concurrent_access_never_returns_torn_entries(void) {
+	atomic_store(&torture_hits, 0);
+	atomic_store(&torture_corrupt, 0);
+	thrd_t threads[TORTURE_THREADS];
+	for (uintptr_t i = 0; i < TORTURE_THREADS; i++) {
+		TEST_ASSERT_EQUAL(thrd_success, thrd_create(&threads[i], torture_thread, (void *) i));
+	}
+	for (int i = 0; i < TORTURE_THREADS; i++) {
+		thrd_join(threads[i], NULL);
+	}
+	TEST_ASSERT_TRUE(atomic_load(&torture_hits) > 0);
+	TEST_ASSERT_EQUAL(0, atomic_load(&torture_corrupt));
+}
+
+static bool shared_segment_exists(void) {
+	int fd = shm_open(SHARED_NAME, O_RDONLY, 0);
+	if (fd < 0)
+		return false;
+	close(fd);
+	return true;
+}
+
+void test_shared_table_keeps_entries_and_is_removed_on_detach(void) {
+	shm_unlink(SHARED_NAME);
+	uint32_t size_mb = 0;
+	TEST_ASSERT_TRUE(ttable_attach_shared(SHARED_NAME, TT_SIZE_MB, SHARED_SEED, &size_mb));
+	TEST_ASSERT_EQUAL(TT_SIZE_MB, size_mb);
+	TEST_ASSERT_TRUE(shared_segment_exists());
+
+	uint64_t key = bucket_key(77, 5);
+	ttable_store(key, 6, 40, TT_NO_EVAL, key_move(key), BOUND_LOWER, 0);
+	// a second attachment finds what the first one stored, whatever size it asks for
+	TEST_ASSERT_TRUE(ttable_attach_shared(SHARED_NAME, TT_SIZE_MB * 4, SHARED_SEED, &size_mb));
+	TEST_ASSERT_EQUAL(TT_SIZE_MB, size_mb);
+	TEntry e = {0};
+	TEST_ASSERT_TRUE(ttable_probe(key, &e, 0));
+	TEST_ASSERT_EQUAL(40, e.score);
+
+	ttable_resize(TT_SIZE_MB, 1);
+	TEST_ASSERT_FALSE(shared_segment_exists());
+}
+
+void test_reset_only_ages_a_shared_table(void) {
+	shm_unlink(SHARED_NAME);
+	uint32_t size_mb = 0;
+	TEST_ASSERT_TRUE(ttable_attach_shared(SHARED_NAME, TT_SIZE_MB, SHARED_SEED, &size_mb));
+	uint64_t key = bucket_key(31, 9);
+	ttable_store(key, 4, -25, TT_NO_EVAL, key_move(key), BOUND_UPPER, 0);
+	// another process could attach at any moment, so even the only user doesnt clear it
+	ttable_reset(1);
+	TEntry e = {0};
+	TEST_ASSERT_TRUE(ttable_probe(key, &e, 0));
+	TEST_ASSERT_EQUAL(-25, e.score);
+
+	ttable_resize(TT_SIZE_MB, 1);
+	TEST_ASSERT_FALSE(ttable_probe(key, &e, 0));
+	TEST_ASSERT_FALSE(shared_segment_exists());
+}
+
+void test_shared_table_ignores_evals_once_the_evaluation_changed(void) {
+	shm_unlink(SHARED_NAME);
+	uint32_t size_mb = 0;
+	TEST_ASSERT_TRUE(ttable_attach_shared(SHARED_NAME, TT_SIZE_MB, SHARED_SEED, &size_mb));
+	uint64_t key = bucket_key(12, 3);
+	ttable_store(key, 5, 30, 70, key_move(key), BOUND_EXACT, 0);
+	ttable_eval_changed(1);
+	// the entry itself is still good, only its eval came from the previous evaluation
+	TEntry e = {0};
+	TEST_ASSERT_TRUE(ttable_probe(key, &e, 0));
+	TEST_ASSERT_EQUAL(30, e.score);
+	TEST_ASSERT_EQUAL(TT_NO_EVAL, e.eval);
+	ttable_store(key, 6, 35, TT_NO_EVAL, NO_MOVE, BOUND_EXACT, 0);
+	TEST_ASSERT_TRUE(ttable_probe(key, &e, 0));
+	TEST_ASSERT_EQUAL(TT_NO_EVAL, e.eval);
+
+	// a private table is cleared instead and keeps the evals stored after the change
+	ttable_resize(TT_SIZE_MB, 1);
+	ttable_store(key, 5, 30, 70, key_move(key), BOUND_EXACT, 0);
+	ttable_eval_changed(1);
+	TEST_ASSERT_FALSE(ttable_probe(key, &e, 0));
+	ttable_store(key, 5, 30, 80, key_move(key), BOUND_EXACT, 0);
+	TEST_ASSERT_TRUE(ttable_probe(key, &e, 0));
+	TEST_ASSERT_EQUAL(80, e.eval);
+	TEST_ASSERT_FALSE(shared_segment_exists());
+}
+
+static bool signal_fd(int fd) {
+	char byte = 1;
+	return write(fd, &byte, 1) == 1;
+}
+
+static bool wait_fd(int fd) {
+	char byte;
+	return read(fd, &byte, 1) == 1 && byte;
+}
+
+void test_searches_of_other_processes_keep_live_entries(void) {
+	shm_unlink(SHARED_NAME);
+	int to_child[2], to_parent[2];
+	TEST_ASSERT_EQUAL(0, pipe(to_child));
+	TEST_ASSERT_EQUAL(0, pipe(to_parent));
+	// the child stands in for another engine searching the same table, every search of its own
+	// fills the bucket of the entry the parent relies on with shallow entries
+	pid_t child = fork();
+	TEST_ASSERT_TRUE(child >= 0);
+	if (child == 0) {
+		// with the parent's ends closed a failed parent leaves the child reading end of file
+		close(to_child[1]);
+		close(to_parent[0]);
+		uint32_t child_mb = 0;
+		if (!ttable_attach_shared(SHARED_NAME, TT_SIZE_MB, SHARED_SEED, &child_mb) ||
+			!signal_fd(to_parent[1]))
+			_exit(1);
+		for (int search = 0; search < 3; search++) {
+			if (!wait_fd(to_child[0]))
+				_exit(1);
+			ttable_new_search();
+			for (uint16_t tag = 0; tag < 16; tag++) {
+				uint64_t key = bucket_key(100 + 16 * search + tag, 0);
+				ttable_store(key, 2, 0, TT_NO_EVAL, NO_MOVE, BOUND_EXACT, 0);
+			}
+			if (!signal_fd(to_parent[1]))
+				_exit(1);
+		}
+		ttable_destroy();
+		_exit(0);
+	}
+	close(to_child[0]);
+	close(to_parent[1]);
+	TEST_ASSERT_TRUE(wait_fd(to_parent[0]));
+
+	uint32_t size_mb = 0;
+	TEST_ASSERT_TRUE(ttable_attach_shared(SHARED_NAME, TT_SIZE_MB, SHARED_SEED, &size_mb));
+	uint64_t key = bucket_key(31, 0);
+	ttable_store(key, 10, 55, TT_NO_EVAL, key_move(key), BOUND_EXACT, 0);
+	for (int search = 0; search < 3; search++) {
+		TEST_ASSERT_TRUE(signal_fd(to_child[1]));
+		TEST_ASSERT_TRUE(wait_fd(to_parent[0]));
+		TEntry e = {0};
+		TEST_ASSERT_TRUE(ttable_probe(key, &e, 0));
+		TEST_ASSERT_EQUAL(55, e.score);
+		ttable_new_search();
+	}
+	TEST_ASSERT_GREATER_THAN(0, ttable_hashfull());
+
+	int status = 0;
+	TEST_ASSERT_EQUAL(child, waitpid(child, &status, 0));
+	TEST_ASSERT_EQUAL(0, status);
+	close(to_child[1]);
+	close(to_parent[0]);
+	ttable_resize(TT_SIZE_MB, 1);
+	TEST_ASSERT_FALSE(shared_segment_exists());
+}
+
+void test_shared_table_rejects_other_zobrist_seed(void) {
+	shm_unlink(SHARED_NAME);
+	uint32_t size_mb = 0;
+	TEST_ASSERT_TRUE(ttable_attach_shared(SHARED_NAME, TT_SIZE_MB, SHARED_SEED, &size_mb));
+	TEST_ASSERT_FALSE(ttable_attach_shared(SHARED_NAME, TT_SIZE_MB, SHARED_SEED + 1, &size_mb));
+	ttable_resize(TT_SIZE_MB, 1);
+	TEST_ASSERT_FALSE(shared_segment_exists());
+}
+
+int main(void) {
+	UNITY_BEGIN();
+	RUN_TEST(test_probe_returns_stored_entry);
+	RUN_TEST(test_probe_misses_other_key_in_same_bucket);
+	RUN_TEST(test_mate_scores_are_relative_to_the_node);
+	RUN_TEST(test_shallower_store_keeps_deeper_entry);
+	RUN_TEST(test_store_without_eval_keeps_known_eval);
+	RUN_TEST(test_full_bucket_replaces_shallowest_entry);
+	RUN_TEST(test_concurrent_access_never_returns_torn_entries);
+	RUN_TEST(test_shared_table_keeps_entries_and_is_removed_on_detach);
+	RUN_TEST(test_reset_only_ages_a_shared_table);
+	RUN_TEST(test_searches_of_other_processes_keep_live_entries);
+	RUN_TEST(test_shared_table_ignores_evals_once_the_evaluation_changed);
+	RUN_TEST(test_shared_table_rejects_other_zobrist_seed);
+	return UNITY_END();
+}